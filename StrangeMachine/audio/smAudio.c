@@ -24,7 +24,7 @@
 #define GEN_VALUE_TYPE		       ma_sound *
 #define GEN_HASH_KEY_FN(_key)	       str8_hash(_key)
 #define GEN_CMP_KEY_FN(_key_a, _key_b) str8_eq(_key_a, _key_b)
-#include "core/smHashMap.inl"
+#include "core/smFlatHashMap.inl"
 
 struct audio_manager
 {
@@ -45,6 +45,10 @@ struct audio_manager
 
 	array(ma_sound) audios;
 	struct str8_audio_map map;
+
+	// fs_file of every file opened through the VFS. The resource manager opens and closes them from its job thread
+	struct pool_allocator files;
+	struct lock files_lock;
 };
 
 static struct audio_manager AC; // Audio Context
@@ -128,7 +132,9 @@ sm__physfs_vfs_open(sm__maybe_unused ma_vfs *vfs, const i8 *file_path, ma_uint32
 		return (MA_INVALID_ARGS);
 	}
 
-	struct fs_file *f = arena_reserve(&AC.arena, sizeof(struct fs_file));
+	sync_lock_enter(&AC.files_lock);
+	struct fs_file *f = pool_alloc(&AC.files);
+	sync_lock_exit(&AC.files_lock);
 
 	if ((open_mode & MA_OPEN_MODE_READ) != 0)
 	{
@@ -142,6 +148,10 @@ sm__physfs_vfs_open(sm__maybe_unused ma_vfs *vfs, const i8 *file_path, ma_uint32
 
 	if (!f->ok)
 	{
+		sync_lock_enter(&AC.files_lock);
+		pool_free(&AC.files, f);
+		sync_lock_exit(&AC.files_lock);
+
 		return (MA_ERROR);
 	}
 
@@ -158,7 +168,10 @@ sm__physfs_vfs_close(sm__maybe_unused ma_vfs *pVFS, ma_vfs_file file)
 	struct fs_file *f = (struct fs_file *)file;
 
 	fs_file_close(f);
-	arena_free(&AC.arena, f);
+
+	sync_lock_enter(&AC.files_lock);
+	pool_free(&AC.files, f);
+	sync_lock_exit(&AC.files_lock);
 
 	return (MA_SUCCESS);
 }
@@ -345,13 +358,17 @@ sm__audio_log(sm__maybe_unused void *user_data, u32 level, const i8 *message)
 }
 
 b8
-audio_manager_init(void)
+audio_manager_init(u32 budget)
 {
-	struct buf m_resource = base_memory_reserve(MB(3));
+	struct buf m_resource = base_memory_reserve(budget);
 
 	arena_make(&AC.arena, m_resource);
+	arena_set_name(&AC.arena, str8_from("audio"));
 	arena_validate(&AC.arena);
 
+	pool_allocator_make(&AC.files, &AC.arena, sizeof(struct fs_file), 16);
+	sync_lock_init(&AC.files_lock);
+
 	// Allocation init
 	ma_allocation_callbacks allocation_callback;
 	sm__ma_allocation_callbacks_init(&allocation_callback);
@@ -4,7 +4,7 @@
 #include "core/smCore.h"
 #include "math/smMath.h"
 
-b8 audio_manager_init(void);
+b8 audio_manager_init(u32 budget);
 void audio_manager_teardown(void);
 
 void audio_add_sound(str8 name, str8 file);
@@ -18,6 +18,499 @@ sm__arena_walker(void *ptr, size_t size, i32 used, sm__maybe_unused void *user)
 	printf("used: %d\n", total_used);
 }
 
+// Allocation profiler
+// Opt-in with SM_ALLOC_PROFILER. Every arena allocation is attributed to the file/line that requested it (those
+// come from sm__debug_args, so build with SM_DEBUG as well or every site collapses into "FILE:0"). Live blocks are
+// kept in a pointer table so frees and reallocs can be charged back to their call site.
+#if defined(SM_ALLOC_PROFILER)
+#	define ARENA_PROFILER_MAX_SITES 1024		// power of 2
+#	define ARENA_PROFILER_MAX_LIVE	 (1u << 17) // power of 2
+
+struct sm__arena_profiler_site
+{
+	str8 file;
+	u32 line;
+
+	u32 live_count;
+	u64 live_bytes;
+
+	u32 allocations; // since the last arena_profiler_reset
+	u32 frees;	 // since the last arena_profiler_reset
+	u64 allocated_bytes;
+};
+
+struct sm__arena_profiler_block
+{
+	void *ptr;
+	u32 site;
+	u32 size;
+};
+
+static struct
+{
+	atomic_flag lock;
+
+	u32 site_count;
+	u32 dropped; // blocks that did not fit in the live table
+	struct sm__arena_profiler_site sites[ARENA_PROFILER_MAX_SITES];
+	u16 site_table[ARENA_PROFILER_MAX_SITES * 2]; // open addressing, index + 1, 0 is empty
+
+	struct sm__arena_profiler_block live[ARENA_PROFILER_MAX_LIVE];
+} PC = {.lock = ATOMIC_FLAG_INIT}; // Profiler Context
+
+sm__force_inline u32
+sm__arena_profiler_ptr_hash(void *ptr)
+{
+	u64 value = (u64)(uintptr_t)ptr;
+
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdull;
+	value ^= value >> 33;
+
+	return ((u32)value);
+}
+
+static u32
+sm__arena_profiler_site_get(str8 file, u32 line)
+{
+	const u32 mask = ARRAY_SIZE(PC.site_table) - 1;
+
+	for (u32 i = (str8_hash(file) ^ (line * 0x9e3779b1u)) & mask;; i = (i + 1) & mask)
+	{
+		u32 slot = PC.site_table[i];
+		if (slot == 0)
+		{
+			if (PC.site_count == ARENA_PROFILER_MAX_SITES) { return (ARENA_PROFILER_MAX_SITES - 1); }
+
+			PC.sites[PC.site_count] = (struct sm__arena_profiler_site){.file = file, .line = line};
+			PC.site_table[i] = (u16)++PC.site_count;
+			return (PC.site_count - 1);
+		}
+
+		struct sm__arena_profiler_site *site = &PC.sites[slot - 1];
+		if (site->line == line && str8_eq(site->file, file)) { return (slot - 1); }
+	}
+}
+
+static void
+sm__arena_profiler_alloc(void *ptr, u32 size, str8 file, u32 line)
+{
+	if (ptr == 0) { return; }
+
+	while (atomic_flag_test_and_set_explicit(&PC.lock, memory_order_acquire)) { thread_yield(); }
+
+	u32 site_index = sm__arena_profiler_site_get(file, line);
+	struct sm__arena_profiler_site *site = &PC.sites[site_index];
+	site->allocations++;
+	site->allocated_bytes += size;
+
+	const u32 mask = ARENA_PROFILER_MAX_LIVE - 1;
+	u32 i = sm__arena_profiler_ptr_hash(ptr) & mask;
+	for (u32 probe = 0; probe < ARENA_PROFILER_MAX_LIVE / 2; ++probe, i = (i + 1) & mask)
+	{
+		if (PC.live[i].ptr == 0)
+		{
+			PC.live[i] = (struct sm__arena_profiler_block){.ptr = ptr, .site = site_index, .size = size};
+			site->live_count++;
+			site->live_bytes += size;
+			atomic_flag_clear_explicit(&PC.lock, memory_order_release);
+			return;
+		}
+	}
+	PC.dropped++;
+
+	atomic_flag_clear_explicit(&PC.lock, memory_order_release);
+}
+
+static void
+sm__arena_profiler_free(void *ptr)
+{
+	while (atomic_flag_test_and_set_explicit(&PC.lock, memory_order_acquire)) { thread_yield(); }
+
+	const u32 mask = ARENA_PROFILER_MAX_LIVE - 1;
+	u32 hole = sm__arena_profiler_ptr_hash(ptr) & mask;
+	while (PC.live[hole].ptr && PC.live[hole].ptr != ptr) { hole = (hole + 1) & mask; }
+
+	if (PC.live[hole].ptr)
+	{
+		struct sm__arena_profiler_site *site = &PC.sites[PC.live[hole].site];
+		site->live_count--;
+		site->live_bytes -= PC.live[hole].size;
+		site->frees++;
+
+		// backward shift deletion keeps the probe sequences intact
+		for (u32 i = (hole + 1) & mask; PC.live[i].ptr; i = (i + 1) & mask)
+		{
+			u32 home = sm__arena_profiler_ptr_hash(PC.live[i].ptr) & mask;
+			if (((i - home) & mask) >= ((i - hole) & mask))
+			{
+				PC.live[hole] = PC.live[i];
+				hole = i;
+			}
+		}
+		PC.live[hole] = (struct sm__arena_profiler_block){0};
+	}
+
+	atomic_flag_clear_explicit(&PC.lock, memory_order_release);
+}
+
+static enum arena_profiler_sort sm__arena_profiler_sort_key;
+
+static u64
+sm__arena_profiler_sort_value(const struct sm__arena_profiler_site *site)
+{
+	switch (sm__arena_profiler_sort_key)
+	{
+	case ARENA_PROFILER_SORT_LIVE_BYTES: return (site->live_bytes);
+	case ARENA_PROFILER_SORT_ALLOCATIONS: return (site->allocations);
+	case ARENA_PROFILER_SORT_CHURN: return (site->frees);
+	}
+
+	return (0);
+}
+
+static i32
+sm__arena_profiler_compare(const void *a, const void *b)
+{
+	u64 value_a = sm__arena_profiler_sort_value(&PC.sites[*(const u16 *)a]);
+	u64 value_b = sm__arena_profiler_sort_value(&PC.sites[*(const u16 *)b]);
+
+	return ((value_a < value_b) - (value_a > value_b));
+}
+
+void
+arena_profiler_print(u32 top_n, enum arena_profiler_sort sort)
+{
+	static u16 order[ARENA_PROFILER_MAX_SITES];
+	static struct sm__arena_profiler_site sites[ARENA_PROFILER_MAX_SITES];
+
+	while (atomic_flag_test_and_set_explicit(&PC.lock, memory_order_acquire)) { thread_yield(); }
+	u32 count = PC.site_count;
+	u32 dropped = PC.dropped;
+	memcpy(sites, PC.sites, count * sizeof(struct sm__arena_profiler_site));
+	atomic_flag_clear_explicit(&PC.lock, memory_order_release);
+
+	for (u32 i = 0; i < count; ++i) { order[i] = (u16)i; }
+
+	sm__arena_profiler_sort_key = sort;
+	qsort(order, count, sizeof(u16), sm__arena_profiler_compare);
+
+	log_info(str8_from("allocation profiler: {u3d} call sites, {u3d} untracked blocks"), count, dropped);
+	for (u32 i = 0; i < MIN(top_n, count); ++i)
+	{
+		struct sm__arena_profiler_site *site = &sites[order[i]];
+		log_info(str8_from("  {s}:{u3d} live {u6d} B in {u3d} blocks, {u3d} allocs / {u3d} frees, {u6d} B allocated"),
+		    site->file, site->line, site->live_bytes, site->live_count, site->allocations, site->frees,
+		    site->allocated_bytes);
+	}
+}
+
+void
+arena_profiler_reset(void)
+{
+	while (atomic_flag_test_and_set_explicit(&PC.lock, memory_order_acquire)) { thread_yield(); }
+	for (u32 i = 0; i < PC.site_count; ++i)
+	{
+		PC.sites[i].allocations = 0;
+		PC.sites[i].frees = 0;
+		PC.sites[i].allocated_bytes = 0;
+	}
+	atomic_flag_clear_explicit(&PC.lock, memory_order_release);
+}
+
+#	define sm__arena_profile_alloc(_ptr, _size, _file, _line) sm__arena_profiler_alloc((_ptr), (_size), (_file), (_line))
+#	define sm__arena_profile_free(_ptr)			   sm__arena_profiler_free((_ptr))
+#else
+void
+arena_profiler_print(sm__maybe_unused u32 top_n, sm__maybe_unused enum arena_profiler_sort sort)
+{
+}
+
+void
+arena_profiler_reset(void)
+{
+}
+
+#	define sm__arena_profile_alloc(_ptr, _size, _file, _line)
+#	define sm__arena_profile_free(_ptr)
+#endif
+
+// Thread-local allocation cache
+// Each thread keeps small magazines of free blocks per size class and per arena. Allocations and frees of small
+// blocks are served from the magazine without touching the arena lock, which is only taken to refill an empty
+// magazine or to give back half of a full one. Cached blocks are regular TLSF blocks, so realloc and free through
+// the slow path keep working on them.
+#define ARENA_CACHE_MAX_ARENAS	  32
+#define ARENA_CACHE_CLASS_COUNT	  5 // 16, 32, 64, 128, 256
+#define ARENA_CACHE_MIN_SHIFT	  4
+#define ARENA_CACHE_MAX_SIZE	  (1u << (ARENA_CACHE_MIN_SHIFT + ARENA_CACHE_CLASS_COUNT - 1))
+#define ARENA_CACHE_MAGAZINE_SIZE 16
+#define ARENA_CACHE_BATCH	  (ARENA_CACHE_MAGAZINE_SIZE / 2)
+#define ARENA_CACHE_INVALID_SLOT  UINT32_MAX
+
+struct sm__arena_magazine
+{
+	u32 count;
+	void *blocks[ARENA_CACHE_MAGAZINE_SIZE];
+};
+
+#define ARENA_CACHE_PUBLISH_EVERY 64 // fast path allocations counted locally before touching the shared counter
+
+struct sm__arena_tcache
+{
+	struct arena *arena;
+	u32 gen;
+	u32 pending_allocations;
+	struct sm__arena_magazine magazines[ARENA_CACHE_CLASS_COUNT];
+};
+
+static _Thread_local struct sm__arena_tcache sm__arena_tcache[ARENA_CACHE_MAX_ARENAS];
+static atomic_uint sm__arena_cache_slots; // bitmask of slots owned by live arenas
+static atomic_uint sm__arena_cache_gen;
+
+sm__force_inline void
+sm__arena_lock(struct arena *alloc)
+{
+	sync_lock_enter(&alloc->lock);
+}
+
+sm__force_inline void
+sm__arena_unlock(struct arena *alloc)
+{
+	sync_lock_exit(&alloc->lock);
+}
+
+// usage tracking, call with the arena lock held
+sm__force_inline void
+sm__arena_track_alloc(struct arena *alloc, void *ptr)
+{
+	if (ptr == 0) { return; }
+	alloc->used += (u32)tlsf_block_size(ptr);
+	alloc->peak = MAX(alloc->peak, alloc->used);
+}
+
+sm__force_inline void
+sm__arena_track_free(struct arena *alloc, void *ptr)
+{
+	if (ptr == 0) { return; }
+	alloc->used -= (u32)tlsf_block_size(ptr);
+}
+
+sm__force_inline u32
+sm__arena_cache_class_of_request(u32 size)
+{
+	u32 result;
+
+	result = (size <= (1u << ARENA_CACHE_MIN_SHIFT)) ? 0 : (32 - (u32)__builtin_clz(size - 1)) - ARENA_CACHE_MIN_SHIFT;
+
+	return (result);
+}
+
+// largest class a block of this size can serve
+sm__force_inline u32
+sm__arena_cache_class_of_block(u32 block_size)
+{
+	u32 result;
+
+	result = (31 - (u32)__builtin_clz(block_size)) - ARENA_CACHE_MIN_SHIFT;
+
+	return (result);
+}
+
+static struct sm__arena_tcache *
+sm__arena_tcache_get(struct arena *alloc)
+{
+	struct sm__arena_tcache *result = 0;
+
+	if (alloc->cache_slot == ARENA_CACHE_INVALID_SLOT) { return (result); }
+
+	result = &sm__arena_tcache[alloc->cache_slot];
+	if (result->gen != alloc->cache_gen)
+	{
+		// the slot belonged to an arena that has been released, its blocks are gone with it
+		*result = (struct sm__arena_tcache){.arena = alloc, .gen = alloc->cache_gen};
+	}
+
+	return (result);
+}
+
+static void
+sm__arena_cache_slot_acquire(struct arena *alloc)
+{
+	alloc->cache_slot = ARENA_CACHE_INVALID_SLOT;
+	alloc->cache_gen = atomic_fetch_add(&sm__arena_cache_gen, 1) + 1;
+
+	u32 slots = atomic_load(&sm__arena_cache_slots);
+	while (~slots)
+	{
+		u32 slot = (u32)__builtin_ctz(~slots);
+		if (atomic_compare_exchange_weak(&sm__arena_cache_slots, &slots, slots | BIT(slot)))
+		{
+			alloc->cache_slot = slot;
+			break;
+		}
+	}
+}
+
+static void
+sm__arena_cache_slot_release(struct arena *alloc)
+{
+	if (alloc->cache_slot == ARENA_CACHE_INVALID_SLOT) { return; }
+
+	sm__arena_tcache[alloc->cache_slot] = (struct sm__arena_tcache){0};
+	atomic_fetch_and(&sm__arena_cache_slots, ~(u32)BIT(alloc->cache_slot));
+	alloc->cache_slot = ARENA_CACHE_INVALID_SLOT;
+}
+
+static b32
+sm__arena_cache_refill(struct arena *alloc, struct sm__arena_magazine *magazine, u32 class_index)
+{
+	const u32 block_size = 1u << (class_index + ARENA_CACHE_MIN_SHIFT);
+
+	atomic_fetch_add_explicit(&alloc->counters.slow_path, 1, memory_order_relaxed);
+
+	sm__arena_lock(alloc);
+	while (magazine->count < ARENA_CACHE_BATCH)
+	{
+		void *block = tlsf_malloc(alloc->tlsf, block_size);
+		if (block == 0) { break; }
+		sm__arena_track_alloc(alloc, block);
+		magazine->blocks[magazine->count++] = block;
+	}
+	sm__arena_unlock(alloc);
+
+	return (magazine->count > 0);
+}
+
+// call with the arena lock held
+static void
+sm__arena_cache_drain_locked(struct arena *alloc, struct sm__arena_magazine *magazine, u32 keep)
+{
+	while (magazine->count > keep)
+	{
+		void *block = magazine->blocks[--magazine->count];
+		sm__arena_track_free(alloc, block);
+		tlsf_free(alloc->tlsf, block);
+	}
+}
+
+static void
+sm__arena_cache_drain(struct arena *alloc, struct sm__arena_magazine *magazine, u32 keep)
+{
+	atomic_fetch_add_explicit(&alloc->counters.slow_path, 1, memory_order_relaxed);
+
+	sm__arena_lock(alloc);
+	sm__arena_cache_drain_locked(alloc, magazine, keep);
+	sm__arena_unlock(alloc);
+}
+
+// Gives every block cached by the calling thread back to its arena. Threads must call it before exiting,
+// thread_create does it for you.
+void
+arena_thread_cache_flush(void)
+{
+	for (u32 i = 0; i < ARENA_CACHE_MAX_ARENAS; ++i)
+	{
+		struct sm__arena_tcache *tcache = &sm__arena_tcache[i];
+		if (tcache->arena == 0 || tcache->arena->cache_gen != tcache->gen) { continue; }
+
+		atomic_fetch_add_explicit(
+		    &tcache->arena->counters.allocations, tcache->pending_allocations, memory_order_relaxed);
+		tcache->pending_allocations = 0;
+
+		for (u32 c = 0; c < ARENA_CACHE_CLASS_COUNT; ++c)
+		{
+			if (tcache->magazines[c].count) { sm__arena_cache_drain(tcache->arena, &tcache->magazines[c], 0); }
+		}
+	}
+}
+
+// Returns the calling thread's cached blocks of one arena, used as a last resort before reporting OOM. Call with the
+// arena lock held, the lock is not recursive
+static b32
+sm__arena_cache_reclaim(struct arena *alloc)
+{
+	b32 result = 0;
+
+	if (alloc->cache_slot == ARENA_CACHE_INVALID_SLOT) { return (result); }
+
+	struct sm__arena_tcache *tcache = sm__arena_tcache_get(alloc);
+	for (u32 c = 0; c < ARENA_CACHE_CLASS_COUNT; ++c)
+	{
+		if (tcache->magazines[c].count)
+		{
+			sm__arena_cache_drain_locked(alloc, &tcache->magazines[c], 0);
+			result = 1;
+		}
+	}
+
+	return (result);
+}
+
+static void
+sm__arena_walk(struct arena *alloc, tlsf_walker walker, void *user)
+{
+	for (u32 i = 0; i < alloc->pool_count; ++i) { tlsf_walk_pool(alloc->tlsf_pools[i], walker, user); }
+}
+
+// Adds a new pool big enough for size, call with the arena lock held. Each growth doubles the arena capacity so an
+// arena that keeps running out needs only a handful of pools. Child arenas are bounded and never grow.
+static b32
+sm__arena_grow(struct arena *alloc, u32 size)
+{
+	b32 result = 0;
+
+	if (alloc->parent || alloc->pool_count == ARENA_MAX_POOLS) { return (result); }
+
+	// pool and block headers, the gap tlsf_memalign may need in front of an aligned block and the rounding TLSF
+	// applies to a request before searching its free lists (up to 1/32 of the size)
+	u32 overhead = (u32)(tlsf_pool_overhead() + tlsf_alloc_overhead() + 4 * sizeof(void *)) + (size >> 4);
+	u32 grow_size = MAX(alloc->capacity, size + overhead);
+	grow_size = (grow_size + (u32)tlsf_align_size() - 1) & ~((u32)tlsf_align_size() - 1);
+
+	struct buf memory = base_memory_try_reserve(grow_size);
+	if (memory.data == 0) { return (result); }
+
+	pool_t pool = tlsf_add_pool(alloc->tlsf, memory.data, memory.size);
+	if (pool == 0) { return (result); }
+
+	alloc->tlsf_pools[alloc->pool_count++] = pool;
+	alloc->capacity += memory.size;
+	result = 1;
+
+	return (result);
+}
+
+// Registry of live arenas
+#define ARENA_REGISTRY_MAX 64
+
+static struct arena *sm__arena_registry[ARENA_REGISTRY_MAX];
+static u32 sm__arena_registry_count;
+static atomic_flag sm__arena_registry_lock = ATOMIC_FLAG_INIT;
+
+static void
+sm__arena_registry_add(struct arena *alloc)
+{
+	while (atomic_flag_test_and_set_explicit(&sm__arena_registry_lock, memory_order_acquire)) { thread_yield(); }
+	if (sm__arena_registry_count < ARENA_REGISTRY_MAX) { sm__arena_registry[sm__arena_registry_count++] = alloc; }
+	atomic_flag_clear_explicit(&sm__arena_registry_lock, memory_order_release);
+}
+
+static void
+sm__arena_registry_remove(struct arena *alloc)
+{
+	while (atomic_flag_test_and_set_explicit(&sm__arena_registry_lock, memory_order_acquire)) { thread_yield(); }
+	for (u32 i = 0; i < sm__arena_registry_count; ++i)
+	{
+		if (sm__arena_registry[i] == alloc)
+		{
+			sm__arena_registry[i] = sm__arena_registry[--sm__arena_registry_count];
+			break;
+		}
+	}
+	atomic_flag_clear_explicit(&sm__arena_registry_lock, memory_order_release);
+}
+
 void
 sm__arena_make(struct arena *alloc, struct buf base_memory, str8 file, u32 line)
 {
@@ -41,39 +534,99 @@ sm__arena_make(struct arena *alloc, struct buf base_memory, str8 file, u32 line)
 		exit(1);
 	}
 
-	sync_mutex_init(&alloc->mutex);
+	sync_lock_init(&alloc->lock);
 	alloc->base_memory = base_memory;
 	alloc->tlsf = tlsf;
-	alloc->tlsf_pool = tlsf_pool;
+	alloc->tlsf_pools[0] = tlsf_pool;
+	alloc->pool_count = 1;
+	alloc->capacity = _size;
 	alloc->mem = allocator_mem;
+	alloc->parent = 0;
+	atomic_store(&alloc->counters.slow_path, 0);
+	atomic_store(&alloc->counters.allocations, 0);
+	alloc->name = str8_from("unnamed");
+	alloc->used = 0;
+	alloc->peak = 0;
+	alloc->last_allocations = 0;
+	sm__arena_cache_slot_acquire(alloc);
+	sm__arena_registry_add(alloc);
 }
 
 void
-sm__arena_release(struct arena *alloc, sm__maybe_unused str8 file, sm__maybe_unused u32 line)
+sm__arena_release(struct arena *alloc, str8 file, u32 line)
 {
-	// tlsf_remove_pool(alloc->tlsf, alloc->tlsf_pool);
+	// tlsf_remove_pool(alloc->tlsf, alloc->tlsf_pools[0]);
 
 	// free(alloc->_tlsf_mem);
 	// free(alloc->mem);
-	sync_mutex_release(&alloc->mutex);
+	sm__arena_registry_remove(alloc);
+	sm__arena_cache_slot_release(alloc);
+
+	// a child gives its whole region back in one go, whatever is still allocated in it
+	if (alloc->parent) { sm__arena_free(alloc->parent, alloc->base_memory.data, file, line); }
 
 	*alloc = (struct arena){0};
 }
 
+// The child is a regular arena over a single block of the parent. It never grows, running out of memory in a child
+// is reported like in any other arena instead of spilling into the parent.
+void
+sm__arena_make_child(struct arena *parent, struct arena *child, u32 size, str8 file, u32 line)
+{
+	struct buf memory;
+
+	memory.data = sm__arena_aligned(parent, 16, size, file, line);
+	memory.size = size;
+	if (memory.data == 0)
+	{
+		log__log(LOG_ERRO, file, line, str8_from("error while carving child arena from parent."));
+		exit(1);
+	}
+
+	sm__arena_make(child, memory, file, line);
+	child->parent = parent;
+}
+
 void *
 sm__arena_malloc(struct arena *alloc, u32 size, str8 file, u32 line)
 {
 	void *result = 0;
-	sync_mutex_lock(&alloc->mutex);
+
+	struct sm__arena_tcache *tcache = (size <= ARENA_CACHE_MAX_SIZE) ? sm__arena_tcache_get(alloc) : 0;
+	if (tcache)
+	{
+		u32 class_index = sm__arena_cache_class_of_request(size);
+		struct sm__arena_magazine *magazine = &tcache->magazines[class_index];
+		if (magazine->count || sm__arena_cache_refill(alloc, magazine, class_index))
+		{
+			if (++tcache->pending_allocations == ARENA_CACHE_PUBLISH_EVERY)
+			{
+				atomic_fetch_add_explicit(&alloc->counters.allocations, ARENA_CACHE_PUBLISH_EVERY,
+				    memory_order_relaxed);
+				tcache->pending_allocations = 0;
+			}
+			result = magazine->blocks[--magazine->count];
+			sm__arena_profile_alloc(result, size, file, line);
+			return (result);
+		}
+	}
+
+	atomic_fetch_add_explicit(&alloc->counters.slow_path, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&alloc->counters.allocations, 1, memory_order_relaxed);
+	sm__arena_lock(alloc);
 	result = tlsf_malloc(alloc->tlsf, size);
+	if (result == 0 && sm__arena_cache_reclaim(alloc)) { result = tlsf_malloc(alloc->tlsf, size); }
+	if (result == 0 && sm__arena_grow(alloc, size)) { result = tlsf_malloc(alloc->tlsf, size); }
+	sm__arena_track_alloc(alloc, result);
 	if (result == 0)
 	{
-		tlsf_walk_pool(alloc->tlsf_pool, sm__arena_walker, 0);
+		sm__arena_walk(alloc, sm__arena_walker, 0);
 		log__log(LOG_ERRO, file, line,
 		    str8_from("OOM: error while allocating memory. Consider increasing the arena size"));
 		sm__assert(result);
 	}
-	sync_mutex_unlock(&alloc->mutex);
+	sm__arena_unlock(alloc);
+	sm__arena_profile_alloc(result, size, file, line);
 
 	return (result);
 }
@@ -83,16 +636,35 @@ sm__arena_realloc(struct arena *alloc, void *ptr, u32 size, str8 file, u32 line)
 {
 	void *result = 0;
 
-	sync_mutex_lock(&alloc->mutex);
+	// tlsf_realloc frees the block on a zero size, the retries below would free it again
+	if (size == 0)
+	{
+		sm__arena_free(alloc, ptr, file, line);
+		return (result);
+	}
+
+	atomic_fetch_add_explicit(&alloc->counters.slow_path, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&alloc->counters.allocations, 1, memory_order_relaxed);
+	sm__arena_lock(alloc);
+	sm__arena_track_free(alloc, ptr);
+	// a failed resize leaves ptr untouched, so retrying after making room is safe
 	result = tlsf_realloc(alloc->tlsf, ptr, size);
+	if (result == 0 && sm__arena_cache_reclaim(alloc)) { result = tlsf_realloc(alloc->tlsf, ptr, size); }
+	if (result == 0 && sm__arena_grow(alloc, size)) { result = tlsf_realloc(alloc->tlsf, ptr, size); }
+	sm__arena_track_alloc(alloc, result ? result : ptr);
 	if (result == 0)
 	{
-		tlsf_walk_pool(alloc->tlsf_pool, sm__arena_walker, 0);
+		sm__arena_walk(alloc, sm__arena_walker, 0);
 		log__log(LOG_ERRO, file, line,
 		    str8_from("OOM: error while reallocating memory. Consider increasing the arena size"));
 		sm__assert(result);
 	}
-	sync_mutex_unlock(&alloc->mutex);
+	sm__arena_unlock(alloc);
+	if (result)
+	{
+		sm__arena_profile_free(ptr);
+		sm__arena_profile_alloc(result, size, file, line);
+	}
 
 	return (result);
 }
@@ -101,15 +673,25 @@ void *
 sm__arena_aligned(struct arena *alloc, u32 align, u32 size, str8 file, u32 line)
 {
 	void *result = 0;
-	sync_mutex_lock(&alloc->mutex);
+
+	// TLSF blocks are already aligned to tlsf_align_size(), anything stricter skips the cache
+	if (align <= tlsf_align_size()) { return sm__arena_malloc(alloc, size, file, line); }
+
+	atomic_fetch_add_explicit(&alloc->counters.slow_path, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&alloc->counters.allocations, 1, memory_order_relaxed);
+	sm__arena_lock(alloc);
 	result = tlsf_memalign(alloc->tlsf, align, size);
+	if (result == 0 && sm__arena_cache_reclaim(alloc)) { result = tlsf_memalign(alloc->tlsf, align, size); }
+	if (result == 0 && sm__arena_grow(alloc, size + align)) { result = tlsf_memalign(alloc->tlsf, align, size); }
+	sm__arena_track_alloc(alloc, result);
 	if (result == 0)
 	{
 		log__log(LOG_ERRO, file, line,
 		    str8_from("OOM: error while allocating aligned memory. Consider increasing the arena size"));
 		sm__assert(result);
 	}
-	sync_mutex_unlock(&alloc->mutex);
+	sm__arena_unlock(alloc);
+	sm__arena_profile_alloc(result, size, file, line);
 
 	return (result);
 }
@@ -117,16 +699,123 @@ sm__arena_aligned(struct arena *alloc, u32 align, u32 size, str8 file, u32 line)
 void
 sm__arena_free(struct arena *alloc, void *ptr, sm__maybe_unused str8 file, sm__maybe_unused u32 line)
 {
-	sync_mutex_lock(&alloc->mutex);
+	if (ptr == 0) { return; }
+
+	sm__arena_profile_free(ptr);
+
+	// the block is owned by the caller, reading its size does not race with the allocator
+	u32 block_size = (u32)tlsf_block_size(ptr);
+	struct sm__arena_tcache *tcache =
+	    (block_size >= (1u << ARENA_CACHE_MIN_SHIFT)) ? sm__arena_tcache_get(alloc) : 0;
+	if (tcache)
+	{
+		u32 class_index = MIN(sm__arena_cache_class_of_block(block_size), ARENA_CACHE_CLASS_COUNT - 1);
+		struct sm__arena_magazine *magazine = &tcache->magazines[class_index];
+		if (block_size < (ARENA_CACHE_MAX_SIZE << 1))
+		{
+			if (magazine->count == ARENA_CACHE_MAGAZINE_SIZE)
+			{
+				sm__arena_cache_drain(alloc, magazine, ARENA_CACHE_BATCH);
+			}
+			magazine->blocks[magazine->count++] = ptr;
+			return;
+		}
+	}
+
+	atomic_fetch_add_explicit(&alloc->counters.slow_path, 1, memory_order_relaxed);
+	sm__arena_lock(alloc);
+	sm__arena_track_free(alloc, ptr);
 	tlsf_free(alloc->tlsf, ptr);
-	sync_mutex_unlock(&alloc->mutex);
+	sm__arena_unlock(alloc);
+}
+
+void
+arena_set_name(struct arena *arena, str8 name)
+{
+	arena->name = name;
+}
+
+static void
+sm__arena_stats_walker(sm__maybe_unused void *ptr, size_t size, i32 used, void *user)
+{
+	struct arena_stats *stats = user;
+
+	if (used) { stats->used_blocks++; }
+	else
+	{
+		stats->free_blocks++;
+		stats->free += (u32)size;
+		stats->largest_free = MAX(stats->largest_free, (u32)size);
+	}
+}
+
+struct arena_stats
+arena_stats(struct arena *arena)
+{
+	struct arena_stats result = {0};
+
+	result.name = arena->name;
+	result.size = arena->capacity;
+	result.pool_count = arena->pool_count;
+	result.allocations = atomic_load_explicit(&arena->counters.allocations, memory_order_relaxed);
+	result.slow_path = atomic_load_explicit(&arena->counters.slow_path, memory_order_relaxed);
+	struct lock_stats lock_stats = sync_lock_stats(&arena->lock);
+	result.contended = lock_stats.contended;
+	result.parked = lock_stats.parked;
+
+	// free, largest_free and the block counts are not kept up on the alloc and free paths, only the walk has them
+	sm__arena_lock(arena);
+	sm__arena_walk(arena, sm__arena_stats_walker, &result);
+	result.used = arena->used;
+	result.peak = arena->peak;
+	result.allocation_rate = result.allocations - arena->last_allocations;
+	arena->last_allocations = result.allocations;
+	sm__arena_unlock(arena);
+
+	return (result);
+}
+
+void
+arena_for_each(b32 (*cb)(struct arena *arena, void *user_data), void *user_data)
+{
+	struct arena *arenas[ARENA_REGISTRY_MAX];
+
+	while (atomic_flag_test_and_set_explicit(&sm__arena_registry_lock, memory_order_acquire)) { thread_yield(); }
+	u32 count = sm__arena_registry_count;
+	memcpy(arenas, sm__arena_registry, count * sizeof(struct arena *));
+	atomic_flag_clear_explicit(&sm__arena_registry_lock, memory_order_release);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (!cb(arenas[i], user_data)) { return; }
+	}
+}
+
+static b32
+sm__arena_print_stats_cb(struct arena *arena, sm__maybe_unused void *user_data)
+{
+	struct arena_stats stats = arena_stats(arena);
+
+	log_info(str8_from("[{s}] used {u3d} KB (peak {u3d} KB) of {u3d} KB in {u3d} pools, largest free {u3d} KB, {u3d} used "
+			   "/ {u3d} free blocks, {u3d} allocations ({u3d} since last), {u3d} slow path, {u3d} contended, {u3d} parked"),
+	    stats.name, B2KB(stats.used), B2KB(stats.peak), B2KB(stats.size), stats.pool_count, B2KB(stats.largest_free),
+	    stats.used_blocks, stats.free_blocks, stats.allocations, stats.allocation_rate, stats.slow_path,
+	    stats.contended, stats.parked);
+
+	return (1);
+}
+
+void
+arena_print_stats(void)
+{
+	arena_for_each(sm__arena_print_stats_cb, 0);
 }
 
 void
 sm__arena_validate(struct arena *arena, sm__maybe_unused str8 file, sm__maybe_unused u32 line)
 {
 	sm__assert(tlsf_check(arena->tlsf) == 0);
-	sm__assert(tlsf_check_pool(arena->tlsf_pool) == 0);
+	for (u32 i = 0; i < arena->pool_count; ++i) { sm__assert(tlsf_check_pool(arena->tlsf_pools[i]) == 0); }
 }
 
 u32
@@ -138,3 +827,177 @@ sm__arena_get_overhead_size(void)
 
 	return (result);
 }
+
+u32
+arena_block_size(void *ptr)
+{
+	u32 result;
+
+	result = (u32)tlsf_block_size(ptr);
+
+	return (result);
+}
+
+// Linear arena
+
+void
+sm__linear_arena_make(struct linear_arena *linear, struct arena *parent, u32 size, str8 file, u32 line)
+{
+	u8 *data = sm__arena_aligned(parent, 16, size, file, line);
+	if (data == 0)
+	{
+		log__log(LOG_ERRO, file, line, str8_from("error while carving linear arena from parent."));
+		exit(1);
+	}
+
+	*linear = (struct linear_arena){
+	    .data = data,
+	    .size = size,
+	    .parent = parent,
+	};
+}
+
+void
+sm__linear_arena_release(struct linear_arena *linear, str8 file, u32 line)
+{
+	if (linear->parent) { sm__arena_free(linear->parent, linear->data, file, line); }
+
+	*linear = (struct linear_arena){0};
+}
+
+void *
+sm__linear_arena_aligned(struct linear_arena *linear, u32 align, u32 size, str8 file, u32 line)
+{
+	void *result = 0;
+
+	sm__assert(align && (align & (align - 1)) == 0);
+
+	uintptr_t base = (uintptr_t)linear->data;
+	uintptr_t cursor = (base + linear->offset + (align - 1)) & ~(uintptr_t)(align - 1);
+	u32 offset = (u32)(cursor - base);
+
+	if (offset + size > linear->size)
+	{
+		log__log(LOG_ERRO, file, line,
+		    str8_from("OOM: error while allocating linear memory. Consider increasing the arena size"));
+		sm__assert(result);
+		return (result);
+	}
+
+	result = (void *)cursor;
+	linear->offset = offset + size;
+
+	return (result);
+}
+
+void
+linear_arena_reset(struct linear_arena *linear)
+{
+	linear->peak = MAX(linear->peak, linear->offset);
+	linear->offset = 0;
+}
+
+struct arena_temp
+arena_temp_begin(struct linear_arena *linear)
+{
+	struct arena_temp result;
+
+	result.arena = linear;
+	result.offset = linear->offset;
+
+	return (result);
+}
+
+void
+arena_temp_end(struct arena_temp temp)
+{
+	struct linear_arena *linear = temp.arena;
+
+	// marks must be ended in reverse order
+	sm__assert(temp.offset <= linear->offset);
+
+	linear->peak = MAX(linear->peak, linear->offset);
+	linear->offset = temp.offset;
+}
+
+// Frame arena
+
+struct frame_arena_context
+{
+	struct linear_arena slots[FRAME_ARENA_MAX_THREADS];
+	u32 slot_count;
+	atomic_uint bound_count;
+};
+
+static struct frame_arena_context FC; // Frame arena Context
+static _Thread_local struct linear_arena *sm__frame_arena_tls;
+
+b8
+frame_arena_init(u32 size, u32 thread_count)
+{
+	sm__assert(thread_count > 0 && thread_count <= FRAME_ARENA_MAX_THREADS);
+	sm__assert(FC.slot_count == 0);
+
+	struct buf m_frame = base_memory_reserve(size * thread_count);
+	if (m_frame.data == 0) { return (false); }
+
+	for (u32 i = 0; i < thread_count; ++i)
+	{
+		FC.slots[i] = (struct linear_arena){
+		    .data = m_frame.data + i * size,
+		    .size = size,
+		};
+	}
+	FC.slot_count = thread_count;
+	atomic_store(&FC.bound_count, 0);
+
+	// the calling thread (main) always owns the first slot
+	sm__frame_arena_tls = 0;
+	frame_arena_get();
+
+	return (true);
+}
+
+struct linear_arena *
+frame_arena_get(void)
+{
+	struct linear_arena *result = sm__frame_arena_tls;
+
+	if (result == 0)
+	{
+		u32 index = atomic_fetch_add(&FC.bound_count, 1);
+		if (index >= FC.slot_count)
+		{
+			log_error(str8_from("frame arena: no free slot for thread (max {u3d})"), FC.slot_count);
+			exit(1);
+		}
+
+		result = &FC.slots[index];
+		sm__frame_arena_tls = result;
+	}
+
+	return (result);
+}
+
+// must be called at a sync point, no other thread can be allocating from its frame arena
+void
+frame_arena_reset(void)
+{
+	u32 count = MIN(atomic_load(&FC.bound_count), FC.slot_count);
+
+	for (u32 i = 0; i < count; ++i) { linear_arena_reset(&FC.slots[i]); }
+}
+
+void
+frame_arena_print_stats(void)
+{
+	u32 count = MIN(atomic_load(&FC.bound_count), FC.slot_count);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		struct linear_arena *frame = &FC.slots[i];
+		u32 peak = MAX(frame->peak, frame->offset);
+		log_info(str8_from("frame arena [{u3d}]: high-water mark {u3d} of {u3d} bytes ({f}%)"), i, peak,
+		    frame->size, 100.0f * (f32)peak / (f32)frame->size);
+	}
+}
@@ -10,7 +10,7 @@ sm__array_make2(struct arena *arena, u32 cap, u32 item_size, str8 file, u32 line
 	result = sm__arena_aligned(arena, 16, sm__array_header_size + (cap * item_size), file, line);
 
 	result->len = 0;
-	result->cap = cap;
+	result->cap = (arena_block_size(result) - (u32)sm__array_header_size) / item_size;
 
 	return (result);
 }
@@ -21,16 +21,32 @@ sm__array_release2(struct arena *arena, void *ptr, str8 file, u32 line)
 	sm__arena_free(arena, ptr, file, line);
 }
 
+// Makes room for at least cap items. The block TLSF handed out is often bigger than what was asked for, and a
+// realloc can extend a block in place when its neighbour is free, so the capacity is always taken from the block
+// itself. That slack is used before asking the arena again.
+static struct sm__array_header *
+sm__array_grow(struct arena *arena, struct sm__array_header *raw, u32 cap, u32 item_size, str8 file, u32 line)
+{
+	struct sm__array_header *result = raw;
+
+	u32 usable = (arena_block_size(result) - (u32)sm__array_header_size) / item_size;
+	if (usable < cap)
+	{
+		result = sm__arena_realloc(arena, result, (u32)sm__array_header_size + (cap * item_size), file, line);
+		usable = (arena_block_size(result) - (u32)sm__array_header_size) / item_size;
+	}
+
+	result->cap = usable;
+
+	return (result);
+}
+
 void *
 sm__array_set_len2(struct arena *arena, void *ptr, u32 len, u32 size, str8 file, u32 line)
 {
 	struct sm__array_header *result = (struct sm__array_header *)ptr;
 
-	if (len > result->cap)
-	{
-		result = sm__arena_realloc(arena, ptr, sm__array_header_size + (len * size), file, line);
-		result->cap = len;
-	}
+	if (len > result->cap) { result = sm__array_grow(arena, result, len, size, file, line); }
 
 	result->len = len;
 
@@ -53,6 +69,16 @@ sm__array_set_cap2(struct arena *arena, void *ptr, u32 cap, u32 size, str8 file,
 	return (result);
 }
 
+void *
+sm__array_reserve2(struct arena *arena, void *ptr, u32 cap, u32 item_size, str8 file, u32 line)
+{
+	struct sm__array_header *result = (struct sm__array_header *)ptr;
+
+	if (cap > result->cap) { result = sm__array_grow(arena, result, cap, item_size, file, line); }
+
+	return (result);
+}
+
 void *
 sm__array_push2(struct arena *arena, void *ptr, void *value, size_t size, str8 file, u32 line)
 {
@@ -60,7 +86,8 @@ sm__array_push2(struct arena *arena, void *ptr, void *value, size_t size, str8 f
 
 	if (++result->len > result->cap)
 	{
-		result = sm__array_set_cap2(arena, result, result->cap * 2, (u32)size, file, line);
+		u32 cap = MAX(result->len, result->cap * 2);
+		result = sm__array_grow(arena, result, cap, (u32)size, file, line);
 	}
 
 	memcpy((u8 *)result + sm__array_header_size + (size * (result->len - 1)), value, size);
@@ -68,6 +95,24 @@ sm__array_push2(struct arena *arena, void *ptr, void *value, size_t size, str8 f
 	return (result);
 }
 
+void *
+sm__array_push_n2(struct arena *arena, void *ptr, const void *values, u32 count, u32 item_size, str8 file, u32 line)
+{
+	struct sm__array_header *result = (struct sm__array_header *)ptr;
+
+	u32 len = result->len + count;
+	if (len > result->cap)
+	{
+		u32 cap = MAX(len, result->cap * 2);
+		result = sm__array_grow(arena, result, cap, item_size, file, line);
+	}
+
+	memcpy((u8 *)result + sm__array_header_size + (item_size * result->len), values, item_size * count);
+	result->len = len;
+
+	return (result);
+}
+
 void *
 sm__array_pop2(void *ptr)
 {
@@ -2,26 +2,82 @@
 #include "core/smCore.h"
 #include "core/smMM.h"
 
-static struct dyn_buf BM;
+// Base memory reserves one contiguous range of address space up front and only commits (makes readable/writable)
+// the pages that have actually been handed out. Asking for more than the machine has is therefore cheap, what
+// counts is what the subsystems end up reserving.
+struct base_memory
+{
+	u8 *data;
+
+	u32 len;       // bytes handed out
+	u32 committed; // bytes backed by read/write pages
+	u32 cap;       // bytes of address space reserved
+
+	b32 huge_pages;
+};
+
+static struct base_memory BM;
 
 #include <sys/mman.h>
 
+#define BASE_MEMORY_COMMIT_GRANULARITY MB(1)
+#define BASE_MEMORY_HUGE_PAGE_SIZE     MB(2)
+#define BASE_MEMORY_HUGE_PAGE_MIN      MB(4) // reservations from this size on are advised to use huge pages
+
+sm__force_inline u32
+sm__base_memory_align_up(u32 value, u32 align)
+{
+	return ((value + (align - 1)) & ~(align - 1));
+}
+
+static u32
+sm__base_memory_page_size(void)
+{
+	static u32 page_size = 0;
+	if (page_size == 0) { page_size = (u32)sysconf(_SC_PAGESIZE); }
+
+	return (page_size);
+}
+
+static b8
+sm__base_memory_commit(u32 len)
+{
+	if (len <= BM.committed) { return (true); }
+
+#ifndef USE_SM_MALLOC
+	u32 target = MAX(len, BM.committed + BASE_MEMORY_COMMIT_GRANULARITY);
+	target = MIN(sm__base_memory_align_up(target, sm__base_memory_page_size()), BM.cap);
+
+	if (mprotect(BM.data + BM.committed, target - BM.committed, PROT_READ | PROT_WRITE) != 0) { return (false); }
+	BM.committed = target;
+#else
+	BM.committed = BM.cap;
+#endif
+
+	return (true);
+}
+
 b8
-base_memory_init(u32 size)
+base_memory_init(u32 size, b32 huge_pages)
 {
 	assert(BM.data == 0 && BM.len == 0 && BM.cap == 0);
 
+	size = sm__base_memory_align_up(size, sm__base_memory_page_size());
+
 #ifdef USE_SM_MALLOC
 	BM.data = mm_malloc(size);
 #else
-	const i32 prot = PROT_READ | PROT_WRITE;
-	const i32 flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	const i32 prot = PROT_NONE;
+	const i32 flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
 
 	BM.data = mmap(NULL, size, prot, flags, -1, 0);
+	if (BM.data == MAP_FAILED) { BM.data = 0; }
 #endif
 	if (BM.data == 0) { return (false); }
 	BM.len = 0;
+	BM.committed = 0;
 	BM.cap = size;
+	BM.huge_pages = huge_pages;
 
 	return (true);
 }
@@ -32,27 +88,53 @@ base_memory_teardown(void)
 #ifdef USE_SM_MALLOC
 	mm_free(BM.data);
 #else
-	munmap(BM.data, BM.len);
+	munmap(BM.data, BM.cap);
 #endif
-	BM.len = 0;
-	BM.cap = 0;
+	BM = (struct base_memory){0};
+}
+
+u32
+base_memory_reserve_footprint(u32 size, b32 huge_pages)
+{
+	u32 align = (huge_pages && size >= BASE_MEMORY_HUGE_PAGE_MIN) ? BASE_MEMORY_HUGE_PAGE_SIZE : 16;
+
+	return (size + align - 1);
 }
 
 struct buf
-base_memory_reserve(u32 size)
+base_memory_try_reserve(u32 size)
 {
 	struct buf result = {0};
 
-	if (BM.len + size <= BM.cap)
-	{
-		result.data = BM.data + BM.len;
-		result.size = size;
+	u32 offset = sm__base_memory_align_up(BM.len, 16);
+	b32 huge = BM.huge_pages && size >= BASE_MEMORY_HUGE_PAGE_MIN;
+	if (huge) { offset = sm__base_memory_align_up(BM.len, BASE_MEMORY_HUGE_PAGE_SIZE); }
+
+	if ((u64)offset + size > BM.cap || !sm__base_memory_commit(offset + size)) { return (result); }
 
-		BM.len += size;
+#if defined(MADV_HUGEPAGE) && !defined(USE_SM_MALLOC)
+	if (huge)
+	{
+		madvise(BM.data + offset, sm__base_memory_align_up(size, BASE_MEMORY_HUGE_PAGE_SIZE), MADV_HUGEPAGE);
 	}
-	else
+#endif
+
+	result.data = BM.data + offset;
+	result.size = size;
+
+	BM.len = offset + size;
+
+	return (result);
+}
+
+struct buf
+base_memory_reserve(u32 size)
+{
+	struct buf result = base_memory_try_reserve(size);
+
+	if (result.data == 0)
 	{
-		printf("base memory overflow: %d\n", size + BM.len);
+		printf("base memory overflow: %u of %u bytes reserved\n", size + BM.len, BM.cap);
 		exit(1);
 	}
 
@@ -64,6 +146,12 @@ base_memory_begin(void)
 {
 	struct buf result;
 
+	if (!sm__base_memory_commit(BM.cap))
+	{
+		printf("base memory: error while committing %u bytes\n", BM.cap);
+		exit(1);
+	}
+
 	result.data = BM.data + BM.len;
 	result.size = BM.cap - BM.len;
 
@@ -79,6 +79,7 @@ struct core
 		CORE_SOUND = BIT(5),
 		CORE_RENDERER = BIT(6),
 		CORE_STAGE = BIT(7),
+		CORE_JOBS = BIT(8),
 
 		SM__CORE_ENFORCE_ENUM_SIZE = 0x7fffffff
 	} modules;
@@ -104,6 +105,17 @@ struct core
 
 static struct core CC; // Context Core
 
+#define CORE_FRAME_ARENA_THREADS 4 // main thread and spares for threads outside the job system, workers are added
+
+// defaults for struct core_init memory settings
+#define CORE_DEFAULT_TOTAL_MEMORY    GB(1)
+#define CORE_DEFAULT_BUDGET_RESOURCE MB(15)
+#define CORE_DEFAULT_BUDGET_RENDERER MB(1)
+#define CORE_DEFAULT_BUDGET_AUDIO    MB(3)
+#define CORE_DEFAULT_BUDGET_STAGE    MB(8)
+#define CORE_DEFAULT_BUDGET_USER     MB(3)
+#define CORE_DEFAULT_BUDGET_FRAME    KB(256)
+
 static b8
 window_init(str8 title, u32 width, u32 height)
 {
@@ -173,6 +185,7 @@ sm__core_teardown_modules(void)
 	if (CC.modules & CORE_RESOURCE) { resource_manager_teardown(); }
 	if (CC.modules & CORE_SOUND) { audio_manager_teardown(); }
 	if (CC.modules & CORE_WINDOW) { window_teardown(&CC.window); }
+	if (CC.modules & CORE_JOBS) { job_system_teardown(); }
 	if (CC.modules & CORE_LOG) { log_teardown(); }
 	if (CC.modules & CORE_STR8) { str8_teardown(); }
 	if (CC.modules & CORE_MEMORY) { base_memory_teardown(); }
@@ -183,8 +196,35 @@ core_init(struct core_init *core_init)
 {
 	sm__assert(core_init);
 
-	u32 base_size = MAX(core_init->total_memory, MB(4));
-	if (!base_memory_init(base_size))
+	// clang-format off
+	u32 budget_resource = core_init->budget.resource ? core_init->budget.resource : CORE_DEFAULT_BUDGET_RESOURCE;
+	u32 budget_renderer = core_init->budget.renderer ? core_init->budget.renderer : CORE_DEFAULT_BUDGET_RENDERER;
+	u32 budget_audio    = core_init->budget.audio    ? core_init->budget.audio    : CORE_DEFAULT_BUDGET_AUDIO;
+	u32 budget_stage    = core_init->budget.stage    ? core_init->budget.stage    : CORE_DEFAULT_BUDGET_STAGE;
+	u32 budget_user     = core_init->budget.user     ? core_init->budget.user     : CORE_DEFAULT_BUDGET_USER;
+	u32 budget_frame    = core_init->budget.frame    ? core_init->budget.frame    : CORE_DEFAULT_BUDGET_FRAME;
+	// clang-format on
+
+	u32 job_workers = 0;
+	if (core_init->job_workers > 0) { job_workers = (u32)core_init->job_workers; }
+	else if (core_init->job_workers == 0) { job_workers = thread_hardware_concurrency() - 1; }
+	job_workers = MIN(job_workers, JOB_MAX_WORKERS);
+
+	u32 frame_threads = MIN(CORE_FRAME_ARENA_THREADS + job_workers, FRAME_ARENA_MAX_THREADS);
+
+	// with huge pages the big reservations start on a huge page boundary, the padding in front of them counts too.
+	// MB(1) covers the small reservations of the log and the job system
+	b32 huge_pages = core_init->huge_pages;
+	u32 budget_total = base_memory_reserve_footprint(budget_resource, huge_pages) +
+			   base_memory_reserve_footprint(budget_renderer, huge_pages) +
+			   base_memory_reserve_footprint(budget_audio, huge_pages) +
+			   base_memory_reserve_footprint(budget_stage, huge_pages) +
+			   base_memory_reserve_footprint(budget_user, huge_pages) +
+			   base_memory_reserve_footprint(budget_frame * frame_threads, huge_pages) + MB(1);
+
+	u32 base_size = core_init->total_memory ? core_init->total_memory : CORE_DEFAULT_TOTAL_MEMORY;
+	base_size = MAX(base_size, budget_total);
+	if (!base_memory_init(base_size, huge_pages))
 	{
 		sm__core_teardown_modules();
 		str8_println(str8_from("error initializing core"));
@@ -211,6 +251,21 @@ core_init(struct core_init *core_init)
 	}
 	CC.modules |= CORE_LOG;
 
+	if (!frame_arena_init(budget_frame, frame_threads))
+	{
+		sm__core_teardown_modules();
+		str8_println(str8_from("error initializing frame arena"));
+		return (false);
+	}
+
+	if (!job_system_init(job_workers))
+	{
+		sm__core_teardown_modules();
+		str8_println(str8_from("error initializing job system"));
+		return (false);
+	}
+	CC.modules |= CORE_JOBS;
+
 	if (!window_init(core_init->title, core_init->w, core_init->h))
 	{
 		sm__core_teardown_modules();
@@ -219,7 +274,7 @@ core_init(struct core_init *core_init)
 	}
 	CC.modules |= CORE_WINDOW;
 
-	if (!resource_manager_init(core_init->argv, core_init->assets_folder))
+	if (!resource_manager_init(core_init->argv, core_init->assets_folder, budget_resource))
 	{
 		sm__core_teardown_modules();
 		str8_println(str8_from("error initializing resource"));
@@ -229,7 +284,7 @@ core_init(struct core_init *core_init)
 	sm__resource_map_dirs(dirs, ARRAY_SIZE(dirs));
 	CC.modules |= CORE_RESOURCE;
 
-	if (!audio_manager_init())
+	if (!audio_manager_init(budget_audio))
 	{
 		sm__core_teardown_modules();
 		str8_println(str8_from("error initializing sound"));
@@ -237,7 +292,7 @@ core_init(struct core_init *core_init)
 	}
 	CC.modules |= CORE_SOUND;
 
-	if (!renderer_init(core_init->w, core_init->h))
+	if (!renderer_init(core_init->w, core_init->h, budget_renderer))
 	{
 		sm__core_teardown_modules();
 		str8_println(str8_from("error initializing renderer"));
@@ -246,7 +301,7 @@ core_init(struct core_init *core_init)
 	CC.modules |= CORE_RENDERER;
 	// renderer_on_resize(core_init->w, core_init->h);
 
-	struct buf m_scene = base_memory_reserve(MB(8));
+	struct buf m_scene = base_memory_reserve(budget_stage);
 	if (!stage_init(m_scene))
 	{
 		sm__core_teardown_modules();
@@ -270,7 +325,8 @@ core_init(struct core_init *core_init)
 
 	CC.user_data = core_init->user_data;
 
-	arena_make(&CC.user_arena, base_memory_reserve(MB(3)));
+	arena_make(&CC.user_arena, base_memory_reserve(budget_user));
+	arena_set_name(&CC.user_arena, str8_from("user"));
 	arena_validate(&CC.user_arena);
 
 	struct ctx ctx = {
@@ -279,6 +335,8 @@ core_init(struct core_init *core_init)
 	    .win_width = CC.window.width,
 	    .win_height = CC.window.height,
 	    .arena = &CC.user_arena,
+	    .frame = frame_arena_get(),
+	    .jobs = job_system_get(),
 	    .user_data = CC.user_data,
 	};
 
@@ -307,6 +365,10 @@ core_teardown(void)
 	    .user_data = CC.user_data,
 	};
 
+	// before the subsystems release their arenas, which takes them out of the report
+	frame_arena_print_stats();
+	arena_print_stats();
+
 	renderer_teardown();
 
 	audio_manager_teardown();
@@ -315,6 +377,8 @@ core_teardown(void)
 
 	window_teardown(&CC.window);
 
+	job_system_teardown();
+
 	log_teardown();
 
 	str8_teardown();
@@ -549,6 +613,8 @@ core_main_loop(void)
 		    .win_width = CC.window.width,
 		    .win_height = CC.window.height,
 		    .arena = &CC.user_arena,
+		    .frame = frame_arena_get(),
+		    .jobs = job_system_get(),
 		    .user_data = CC.user_data,
 		};
 
@@ -566,6 +632,8 @@ core_main_loop(void)
 		    .win_width = CC.window.width,
 		    .win_height = CC.window.height,
 		    .arena = &CC.user_arena,
+		    .frame = frame_arena_get(),
+		    .jobs = job_system_get(),
 		    .user_data = CC.user_data,
 		};
 
@@ -594,6 +662,7 @@ core_main_loop(void)
 			CC.time.frame += waitTime; // Total frame time: update + draw + wait
 		}
 
+		frame_arena_reset();
 		str8_buffer_flush();
 		glfwPollEvents();
 	}
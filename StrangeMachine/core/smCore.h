@@ -9,9 +9,11 @@
 #include "core/smThread.h"
 #include "math/smMath.h"
 
-#define sm__debug_args	 , str8_from(sm__file_name), sm__file_line
+#define sm__debug_args	 , str8_from_cstr_stack(sm__file_name), sm__file_line
 #define sm__debug_params , str8 file, u32 line
 
+struct job_system;
+
 struct ctx
 {
 	f32 time;
@@ -19,6 +21,8 @@ struct ctx
 	f32 fixed_dt;
 	u32 win_width, win_height;
 	struct arena *arena;
+	struct linear_arena *frame;
+	struct job_system *jobs; // 0 when there are no workers, job_submit then runs everything inline
 
 	void *user_data;
 };
@@ -39,24 +43,73 @@ struct buf
 	u32 size;
 };
 
-b8 base_memory_init(u32 size);
+b8 base_memory_init(u32 size, b32 huge_pages);
 void base_memory_teardown(void);
 struct buf base_memory_reserve(u32 size);
+struct buf base_memory_try_reserve(u32 size); // returns an empty buf instead of exiting on overflow
+u32 base_memory_reserve_footprint(u32 size, b32 huge_pages); // size plus the most alignment a reservation can take
 struct buf base_memory_begin(void);
 void base_memory_end(u32 size);
 void base_memory_reset(void);
 
 // Arena
 
+#define ARENA_MAX_POOLS 16
+
 struct arena
 {
-	struct mutex mutex;
+	struct lock lock;
 	struct buf base_memory;
 
 	void *tlsf;
-	void *tlsf_pool;
+
+	// the first pool is carved from base_memory, the others are taken from base memory whenever the arena runs out
+	void *tlsf_pools[ARENA_MAX_POOLS];
+	u32 pool_count;
+	u32 capacity; // bytes managed by TLSF across all pools
 
 	void *mem;
+
+	// set by arena_make_child, the whole region is handed back to the parent on arena_release
+	struct arena *parent;
+
+	str8 name;
+
+	// thread-local cache slot, see ARENA_CACHE_* in smArena.c
+	u32 cache_slot;
+	u32 cache_gen;
+
+	struct
+	{
+		atomic_uint slow_path;	 // refills, overflows and uncached requests that took the lock
+		atomic_uint allocations; // published in batches by the thread caches
+	} counters;
+
+	// guarded by lock
+	u32 used;
+	u32 peak;
+	u32 last_allocations;
+};
+
+struct arena_stats
+{
+	str8 name;
+
+	u32 size;	  // bytes managed by TLSF across all pools
+	u32 pool_count;	  // 1 + times the arena had to grow
+	u32 used;	  // bytes in live blocks, blocks parked in thread caches count as used
+	u32 free;	  // bytes in free blocks
+	u32 largest_free; // biggest allocation that can still succeed
+	u32 used_blocks;
+	u32 free_blocks;
+	u32 peak; // high-water mark of used
+
+	u32 allocations;     // since arena_make
+	u32 allocation_rate; // since the previous arena_stats call on this arena
+
+	u32 slow_path;
+	u32 contended; // times the lock was already held by another thread
+	u32 parked;    // times a thread had to sleep on it
 };
 
 void sm__arena_make(struct arena *alloc, struct buf base_memory, str8 file, u32 line);
@@ -68,6 +121,26 @@ void *sm__arena_aligned(struct arena *alloc, u32 align, u32 size sm__debug_param
 void sm__arena_free(struct arena *alloc, void *ptr sm__debug_params);
 void sm__arena_validate(struct arena *arena sm__debug_params);
 u32 sm__arena_get_overhead_size(void);
+u32 arena_block_size(void *ptr); // usable bytes of a live block, can be more than requested
+void arena_thread_cache_flush(void);
+
+void arena_set_name(struct arena *arena, str8 name);
+// Debug snapshot: walks every TLSF block with the arena locked to get the free figures, so it stalls allocations on
+// that arena for the whole walk. Meant for reports like arena_print_stats, not for sampling every frame
+struct arena_stats arena_stats(struct arena *arena);
+void arena_for_each(b32 (*cb)(struct arena *arena, void *user_data), void *user_data);
+void arena_print_stats(void);
+
+// Allocation profiler, compiled in with SM_ALLOC_PROFILER, otherwise these are no-ops
+enum arena_profiler_sort
+{
+	ARENA_PROFILER_SORT_LIVE_BYTES,
+	ARENA_PROFILER_SORT_ALLOCATIONS, // since the last reset, useful to spot per-frame allocations
+	ARENA_PROFILER_SORT_CHURN,	 // frees since the last reset
+};
+
+void arena_profiler_print(u32 top_n, enum arena_profiler_sort sort);
+void arena_profiler_reset(void);
 
 #define arena_make(_arena, _base_mem)	     sm__arena_make((_arena), (_base_mem)sm__debug_args)
 #define arena_release(_arena)		     sm__arena_release((_arena)sm__debug_args)
@@ -78,6 +151,88 @@ u32 sm__arena_get_overhead_size(void);
 #define arena_validate(_arena)		     sm__arena_validate((_arena)sm__debug_args)
 #define arena_get_overhead_size()	     sm__arena_get_overhead_size();
 
+void sm__arena_make_child(struct arena *parent, struct arena *child, u32 size sm__debug_params);
+#define arena_make_child(_parent, _child, _size) sm__arena_make_child((_parent), (_child), (_size)sm__debug_args)
+
+// Linear arena
+// Bump allocator over a fixed region. Nothing is freed individually: the arena is rewound as a whole, either to a
+// mark taken with arena_temp_begin or all the way with linear_arena_reset. Not thread safe.
+struct linear_arena
+{
+	u8 *data;
+	u32 size;
+	u32 offset;
+
+	u32 peak; // high-water mark across resets
+
+	struct arena *parent; // 0 when the region does not belong to an arena
+};
+
+struct arena_temp
+{
+	struct linear_arena *arena;
+	u32 offset;
+};
+
+void sm__linear_arena_make(struct linear_arena *linear, struct arena *parent, u32 size sm__debug_params);
+void sm__linear_arena_release(struct linear_arena *linear sm__debug_params);
+void *sm__linear_arena_aligned(struct linear_arena *linear, u32 align, u32 size sm__debug_params);
+void linear_arena_reset(struct linear_arena *linear);
+
+struct arena_temp arena_temp_begin(struct linear_arena *linear);
+void arena_temp_end(struct arena_temp temp);
+
+#define linear_arena_make(_linear, _parent, _size) \
+	sm__linear_arena_make((_linear), (_parent), (_size)sm__debug_args)
+#define linear_arena_release(_linear) sm__linear_arena_release((_linear)sm__debug_args)
+#define linear_alloc(_linear, _size)  sm__linear_arena_aligned((_linear), 16, (_size)sm__debug_args)
+#define linear_alloc_aligned(_linear, _align, _size) \
+	sm__linear_arena_aligned((_linear), (_align), (_size)sm__debug_args)
+
+// Frame arena
+// One linear arena per thread. It is rewound at the end of each frame by core_main_loop, so pointers returned by
+// frame_alloc must not outlive the frame. Use arena_temp_begin/end on frame_arena_get() to give scratch memory back
+// earlier.
+#define FRAME_ARENA_MAX_THREADS 16
+
+b8 frame_arena_init(u32 size, u32 thread_count);
+void frame_arena_reset(void);
+void frame_arena_print_stats(void);
+struct linear_arena *frame_arena_get(void);
+
+#define frame_alloc(_size) sm__linear_arena_aligned(frame_arena_get(), 16, (_size)sm__debug_args)
+#define frame_alloc_aligned(_align, _size) \
+	sm__linear_arena_aligned(frame_arena_get(), (_align), (_size)sm__debug_args)
+
+// Pool allocator
+// Fixed-size blocks with an intrusive free list. Memory is carved from the parent arena one page at a time and only
+// returned to it on pool_allocator_release. Not thread safe.
+struct pool_allocator
+{
+	struct arena *arena;
+
+	u32 block_size;
+	u32 blocks_per_page;
+
+	void *free_list;
+	void *pages;
+
+	u32 used;
+	u32 capacity;
+};
+
+void sm__pool_allocator_make(
+    struct pool_allocator *pool, struct arena *arena, u32 block_size, u32 blocks_per_page sm__debug_params);
+void sm__pool_allocator_release(struct pool_allocator *pool sm__debug_params);
+void *sm__pool_allocator_alloc(struct pool_allocator *pool sm__debug_params);
+void sm__pool_allocator_free(struct pool_allocator *pool, void *ptr sm__debug_params);
+
+#define pool_allocator_make(_pool, _arena, _block_size, _blocks_per_page) \
+	sm__pool_allocator_make((_pool), (_arena), (_block_size), (_blocks_per_page)sm__debug_args)
+#define pool_allocator_release(_pool) sm__pool_allocator_release((_pool)sm__debug_args)
+#define pool_alloc(_pool)	      sm__pool_allocator_alloc((_pool)sm__debug_args)
+#define pool_free(_pool, _ptr)	      sm__pool_allocator_free((_pool), (_ptr)sm__debug_args)
+
 // Array
 struct sm__array_header
 {
@@ -95,7 +250,9 @@ void *sm__array_make2(struct arena *arena, u32 cap, u32 item_size sm__debug_para
 void sm__array_release2(struct arena *arena, void *ptr sm__debug_params);
 void *sm__array_set_len2(struct arena *arena, void *ptr, u32 len, u32 size sm__debug_params);
 void *sm__array_set_cap2(struct arena *arena, void *ptr, u32 cap, u32 size sm__debug_params);
+void *sm__array_reserve2(struct arena *arena, void *ptr, u32 cap, u32 item_size sm__debug_params);
 void *sm__array_push2(struct arena *arena, void *ptr, void *value, size_t size sm__debug_params);
+void *sm__array_push_n2(struct arena *arena, void *ptr, const void *values, u32 count, u32 item_size sm__debug_params);
 void *sm__array_pop2(void *ptr);
 void *sm__array_copy2(struct arena *arena, void *dest_ptr, const void *src_ptr, size_t item_size sm__debug_params);
 
@@ -147,6 +304,20 @@ void *sm__array_copy2(struct arena *arena, void *dest_ptr, const void *src_ptr,
 		(_ptr) = (typeof((_ptr)))sm__r2a(raw);                                                             \
 	} while (0)
 
+// grows the capacity to at least _cap without touching the length
+#define array_reserve(_arena, _ptr, _cap)                                                                          \
+	do                                                                                                         \
+	{                                                                                                          \
+		if (!(_ptr) && (_cap) == 0)                                                                        \
+		{                                                                                                  \
+			continue;                                                                                  \
+		}                                                                                                  \
+		struct sm__array_header *raw =                                                                     \
+		    !(_ptr) ? sm__array_make2((_arena), (_cap), sizeof(*(_ptr)) sm__debug_args) : sm__a2r((_ptr)); \
+		raw = sm__array_reserve2((_arena), raw, (_cap), sizeof(*(_ptr)) sm__debug_args);                   \
+		(_ptr) = (typeof((_ptr)))sm__r2a(raw);                                                             \
+	} while (0)
+
 #define array_len(_ptr) ((_ptr) == 0 ? 0 : (((struct sm__array_header *)(_ptr)) - 1)->len)
 #define array_cap(_ptr) ((_ptr) == 0 ? 0 : (((struct sm__array_header *)(_ptr)) - 1)->cap)
 #define array_size(_ptr) \
@@ -162,6 +333,21 @@ void *sm__array_copy2(struct arena *arena, void *dest_ptr, const void *src_ptr,
 		(_ptr) = (typeof((_ptr)))sm__r2a(raw);                                                        \
 	} while (0)
 
+// appends _count items copied from _values
+#define array_push_n(_arena, _ptr, _values, _count)                                                                  \
+	do                                                                                                           \
+	{                                                                                                            \
+		if ((_count) == 0)                                                                                   \
+		{                                                                                                    \
+			continue;                                                                                    \
+		}                                                                                                    \
+		(void)sizeof((_ptr) == (_values));                                                                   \
+		struct sm__array_header *raw =                                                                       \
+		    !(_ptr) ? sm__array_make2((_arena), (_count), sizeof(*(_ptr)) sm__debug_args) : sm__a2r((_ptr)); \
+		raw = sm__array_push_n2((_arena), raw, (_values), (_count), sizeof(*(_ptr)) sm__debug_args);         \
+		(_ptr) = (typeof((_ptr)))sm__r2a(raw);                                                               \
+	} while (0)
+
 /* WARNING: do not use array_pop inside a loop that depends array_len.
  * like:
  *  for (u32 i = 0; i < array_len(array); ++i) {
@@ -203,6 +389,29 @@ void *sm__array_copy2(struct arena *arena, void *dest_ptr, const void *src_ptr,
 		raw->len = raw->len - ___nnn;                                                                        \
 	} while (0)
 
+// O(1) removal, the last item takes the place of the removed one so the order is not kept
+#define array_swap_remove(_ptr, i)                                   \
+	do                                                           \
+	{                                                            \
+		struct sm__array_header *raw = sm__a2r(_ptr);        \
+		assert((u32)(i) < raw->len && "index out of range"); \
+		if ((u32)(i) != raw->len - 1)                        \
+		{                                                    \
+			(_ptr)[(i)] = (_ptr)[raw->len - 1];          \
+		}                                                    \
+		raw->len--;                                          \
+	} while (0)
+
+// drops every item and keeps the memory around for reuse
+#define array_clear(_ptr)                         \
+	do                                        \
+	{                                         \
+		if (_ptr)                         \
+		{                                 \
+			sm__a2r((_ptr))->len = 0; \
+		}                                 \
+	} while (0)
+
 #define array_last_item(_ptr)                                       \
 	((_ptr) == 0 ? 0                                            \
 	    : ((((struct sm__array_header *)(_ptr)) - 1)->len == 0) \
@@ -238,10 +447,32 @@ struct DLLnode
 #define dll_remove_multiple(n1, n2)	    (dll_remove_multiple_((n1), (n2)))
 
 // Resource
-b32 resource_manager_init(char *argv[], str8 assets_folder);
+b32 resource_manager_init(char *argv[], str8 assets_folder, u32 budget);
 void resource_manager_teardown(void);
 struct arena *resource_get_arena(void);
 
+// Job system
+// A pool of worker threads, each with its own work-stealing deque. The main thread takes part too: job_wait runs
+// pending jobs, its own first and then stolen ones, until the counter drops to zero.
+#define JOB_MAX_WORKERS 12
+
+typedef void (*job_f)(void *user_data, u32 index);
+
+struct job_counter
+{
+	atomic_uint pending; // jobs submitted against the counter that did not finish yet, zero initialize
+};
+
+b8 job_system_init(u32 worker_count);
+void job_system_teardown(void);
+struct job_system *job_system_get(void);    // 0 when the job system is not running
+u32 job_thread_count(struct job_system *jobs); // workers plus the main thread
+u32 job_thread_index(void);		     // 0 on the main thread, 1..worker_count on workers
+
+// runs fn(user_data, i) for i in [0, count), jobs submitted from a thread that is not part of the system run inline
+void job_submit(struct job_system *jobs, struct job_counter *counter, job_f fn, void *user_data, u32 count);
+void job_wait(struct job_system *jobs, struct job_counter *counter);
+
 // PRNG
 void prng_seed(u64 seed);
 
@@ -284,7 +515,23 @@ struct core_init
 	// window
 	str8 title;
 	u32 w, h;
-	u32 total_memory;
+
+	// memory
+	u32 total_memory; // address space reserved up front, pages are committed on demand
+	b32 huge_pages;	  // advise transparent huge pages for the big reservations
+
+	// initial size of each subsystem arena, 0 picks the default. Arenas grow past it when they run out
+	struct
+	{
+		u32 resource;
+		u32 renderer;
+		u32 audio;
+		u32 stage;
+		u32 user;
+		u32 frame; // per thread
+	} budget;
+
+	i32 job_workers; // worker threads, 0 picks one per hardware thread besides the main one, negative disables them
 
 	u32 target_fps; // Desired FPS 60, 30, 24
 	u32 fixed_fps;	// Useful for physics
@@ -0,0 +1,289 @@
+// Open addressing hash map, same template parameters and API as smHashMap.inl.
+//
+// Entries live inline in a single array next to an array of control bytes. A control byte is either EMPTY or the
+// top 7 bits of the entry hash, so a lookup compares 16 candidates at once with SSE2 and only touches the entries
+// whose tag matches. Probing is linear from the home slot, which allows deletion by shifting the following entries
+// back instead of leaving tombstones behind.
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+#define _CAT3(a, b, c) a##b##c
+#define CAT3(a, b, c)  _CAT3(a, b, c)
+#define FN(name)       CAT3(GEN_NAME, _, name)
+
+#define MAP_GROUP_WIDTH	     16
+#define MAP_CTRL_EMPTY	     ((i8)0x80)
+#define MAP_MIN_CAPACITY     16
+#define MAP_MAX_LOAD(_cap)   (((_cap) >> 3) * 7)
+#define MAP_H2(_hash)	     ((i8)((_hash) >> 25))
+#define MAP_NEXT(_i, _mask)  (((_i) + 1) & (_mask))
+
+struct FN(entry_map)
+{
+	GEN_KEY_TYPE key;
+	u32 hash;
+	GEN_VALUE_TYPE value;
+};
+
+struct FN(result)
+{
+	b32 ok;
+	GEN_VALUE_TYPE value;
+};
+
+struct FN(map)
+{
+	i8 *ctrl; // capacity + MAP_GROUP_WIDTH, the tail mirrors the first group
+	struct FN(entry_map) * entries;
+	u32 count;
+	u32 capacity;
+};
+
+struct FN(map) FN(map_make)(struct arena *arena);
+void FN(map_release)(struct arena *arena, struct FN(map) * map);
+void FN(map_reserve)(struct arena *arena, struct FN(map) * map, u32 count);
+struct FN(result) FN(map_put)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key, GEN_VALUE_TYPE value);
+struct FN(result) FN(map_get)(struct FN(map) * map, GEN_KEY_TYPE key);
+struct FN(result) FN(map_remove)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key);
+
+void FN(for_each)(
+    struct FN(map) * map, b32 (*cb)(GEN_KEY_TYPE key, GEN_VALUE_TYPE value, void *user_data), void *user_data);
+
+static u32
+FN(sm__hash_key)(GEN_KEY_TYPE key)
+{
+	u32 result = 0;
+
+	result = GEN_HASH_KEY_FN(key);
+
+	result += ~(result << 9);
+	result ^= (result >> 14);
+	result += (result << 4);
+	result ^= (result >> 10);
+
+	return (result);
+}
+
+// bit i set when ctrl[i] == tag
+static u32
+FN(sm__group_match)(const i8 *ctrl, i8 tag)
+{
+	u32 result = 0;
+
+#if defined(__SSE2__)
+	__m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+	result = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+#else
+	for (u32 i = 0; i < MAP_GROUP_WIDTH; ++i) { result |= (u32)(ctrl[i] == tag) << i; }
+#endif
+
+	return (result);
+}
+
+static void
+FN(sm__set_ctrl)(struct FN(map) * map, u32 index, i8 value)
+{
+	map->ctrl[index] = value;
+	if (index < MAP_GROUP_WIDTH) { map->ctrl[map->capacity + index] = value; }
+}
+
+static u32
+FN(sm__find_empty)(struct FN(map) * map, u32 hash)
+{
+	u32 mask = map->capacity - 1;
+	u32 pos = hash & mask;
+
+	while (true)
+	{
+		u32 empty = FN(sm__group_match)(map->ctrl + pos, MAP_CTRL_EMPTY);
+		if (empty) { return ((pos + (u32)__builtin_ctz(empty)) & mask); }
+
+		pos = (pos + MAP_GROUP_WIDTH) & mask;
+	}
+}
+
+// returns capacity when not found
+static u32
+FN(sm__find)(struct FN(map) * map, GEN_KEY_TYPE key, u32 hash)
+{
+	u32 mask = map->capacity - 1;
+	u32 pos = hash & mask;
+	i8 tag = MAP_H2(hash);
+
+	while (true)
+	{
+		const i8 *group = map->ctrl + pos;
+
+		u32 match = FN(sm__group_match)(group, tag);
+		while (match)
+		{
+			u32 index = (pos + (u32)__builtin_ctz(match)) & mask;
+			struct FN(entry_map) *entry = &map->entries[index];
+			if (entry->hash == hash && GEN_CMP_KEY_FN(entry->key, key)) { return (index); }
+
+			match &= match - 1;
+		}
+
+		if (FN(sm__group_match)(group, MAP_CTRL_EMPTY)) { return (map->capacity); }
+
+		pos = (pos + MAP_GROUP_WIDTH) & mask;
+	}
+}
+
+static void
+FN(sm__resize)(struct arena *arena, struct FN(map) * map, u32 new_capacity)
+{
+	sm__assert(new_capacity >= MAP_MIN_CAPACITY && (new_capacity & (new_capacity - 1)) == 0);
+
+	struct FN(map) old = *map;
+
+	map->capacity = new_capacity;
+	map->ctrl = arena_reserve(arena, new_capacity + MAP_GROUP_WIDTH);
+	map->entries = arena_reserve(arena, new_capacity * sizeof(struct FN(entry_map)));
+	memset(map->ctrl, MAP_CTRL_EMPTY, new_capacity + MAP_GROUP_WIDTH);
+
+	for (u32 i = 0; i < old.capacity; ++i)
+	{
+		if (old.ctrl[i] < 0) { continue; }
+
+		u32 index = FN(sm__find_empty)(map, old.entries[i].hash);
+		FN(sm__set_ctrl)(map, index, old.ctrl[i]);
+		map->entries[index] = old.entries[i];
+	}
+
+	if (old.ctrl)
+	{
+		arena_free(arena, old.ctrl);
+		arena_free(arena, old.entries);
+	}
+}
+
+struct FN(map) FN(map_make)(struct arena *arena)
+{
+	struct FN(map) result = {0};
+
+	FN(sm__resize)(arena, &result, MAP_MIN_CAPACITY);
+
+	return (result);
+}
+
+void
+FN(map_release)(struct arena *arena, struct FN(map) * map)
+{
+	arena_free(arena, map->ctrl);
+	arena_free(arena, map->entries);
+
+	*map = (struct FN(map)){0};
+}
+
+void
+FN(map_reserve)(struct arena *arena, struct FN(map) * map, u32 count)
+{
+	u32 capacity = map->capacity;
+	while (MAP_MAX_LOAD(capacity) < count) { capacity <<= 1; }
+
+	if (capacity != map->capacity) { FN(sm__resize)(arena, map, capacity); }
+}
+
+struct FN(result) FN(map_put)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key, GEN_VALUE_TYPE value)
+{
+	struct FN(result) result = {0};
+
+	u32 hash = FN(sm__hash_key)(key);
+
+	u32 index = FN(sm__find)(map, key, hash);
+	if (index != map->capacity)
+	{
+		result.ok = true;
+		result.value = map->entries[index].value;
+
+		map->entries[index].value = value;
+
+		return (result);
+	}
+
+	if (map->count + 1 > MAP_MAX_LOAD(map->capacity)) { FN(sm__resize)(arena, map, map->capacity << 1); }
+
+	index = FN(sm__find_empty)(map, hash);
+	FN(sm__set_ctrl)(map, index, MAP_H2(hash));
+	map->entries[index] = (struct FN(entry_map)){.key = key, .hash = hash, .value = value};
+	map->count++;
+
+	return (result);
+}
+
+struct FN(result) FN(map_get)(struct FN(map) * map, GEN_KEY_TYPE key)
+{
+	struct FN(result) result = {0};
+
+	u32 hash = FN(sm__hash_key)(key);
+
+	u32 index = FN(sm__find)(map, key, hash);
+	if (index != map->capacity)
+	{
+		result.ok = true;
+		result.value = map->entries[index].value;
+	}
+
+	return (result);
+}
+
+struct FN(result) FN(map_remove)(sm__maybe_unused struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key)
+{
+	struct FN(result) result = {0};
+
+	u32 hash = FN(sm__hash_key)(key);
+
+	u32 hole = FN(sm__find)(map, key, hash);
+	if (hole == map->capacity) { return (result); }
+
+	result.ok = true;
+	result.value = map->entries[hole].value;
+
+	// backward shift: pull every following entry that may live in the hole without passing its home slot
+	u32 mask = map->capacity - 1;
+	for (u32 i = MAP_NEXT(hole, mask); map->ctrl[i] >= 0; i = MAP_NEXT(i, mask))
+	{
+		u32 home = map->entries[i].hash & mask;
+		if (((i - home) & mask) >= ((i - hole) & mask))
+		{
+			FN(sm__set_ctrl)(map, hole, map->ctrl[i]);
+			map->entries[hole] = map->entries[i];
+			hole = i;
+		}
+	}
+
+	FN(sm__set_ctrl)(map, hole, MAP_CTRL_EMPTY);
+	map->count--;
+
+	return (result);
+}
+
+void
+FN(for_each)(struct FN(map) * map, b32 (*cb)(GEN_KEY_TYPE key, GEN_VALUE_TYPE value, void *user_data), void *user_data)
+{
+	for (u32 i = 0; i < map->capacity; ++i)
+	{
+		if (map->ctrl[i] < 0) { continue; }
+
+		struct FN(entry_map) *entry = &map->entries[i];
+		if (!cb(entry->key, entry->value, user_data)) { return; }
+	}
+}
+
+#undef MAP_GROUP_WIDTH
+#undef MAP_CTRL_EMPTY
+#undef MAP_MIN_CAPACITY
+#undef MAP_MAX_LOAD
+#undef MAP_H2
+#undef MAP_NEXT
+#undef _CAT3
+#undef CAT3
+#undef FN
+#undef GEN_NAME
+#undef GEN_KEY_TYPE
+#undef GEN_VALUE_TYPE
+#undef GEN_HASH_KEY_FN
+#undef GEN_CMP_KEY_FN
@@ -31,7 +31,11 @@ void
 handle_pool_reset(struct handle_pool *pool)
 {
 	pool->len = 0;
-	for (u32 i = 0, c = pool->cap; i < c; i++) { pool->dense[i] = sm__handle_make(0, i); }
+	for (u32 i = 0, c = pool->cap; i < c; i++)
+	{
+		pool->dense[i] = sm__handle_make(0, i);
+		pool->sparse[i] = i;
+	}
 }
 
 static void
@@ -44,6 +48,7 @@ sm__handle_pool_grow(struct arena *arena, struct handle_pool *handle_pool, u32 n
 	for (u32 i = 0; i < size; ++i)
 	{
 		handle_pool->dense[handle_pool->cap + i] = sm__handle_make(0, handle_pool->cap + i);
+		handle_pool->sparse[handle_pool->cap + i] = handle_pool->cap + i;
 	}
 
 	handle_pool->cap = new_capacity;
@@ -57,8 +62,21 @@ handle_pool_copy(struct handle_pool *dest, struct handle_pool *src)
 
 	dest->len = src->len;
 
-	memcpy(dest->dense, src->dense, sizeof(handle_t) * src->len);
-	memcpy(dest->sparse, src->sparse, sizeof(u32) * src->len);
+	// live indices are not bounded by len and free slots carry their generation, so both arrays are copied whole
+	memcpy(dest->dense, src->dense, sizeof(handle_t) * src->cap);
+	memcpy(dest->sparse, src->sparse, sizeof(u32) * src->cap);
+}
+
+void
+handle_pool_reserve(struct arena *arena, struct handle_pool *handle_pool, u32 count)
+{
+	u32 needed = handle_pool->len + count;
+	if (needed <= handle_pool->cap) { return; }
+
+	u32 capacity = MAX(handle_pool->cap, 1u);
+	while (capacity < needed) { capacity <<= 1; }
+
+	sm__handle_pool_grow(arena, handle_pool, capacity);
 }
 
 handle_t
@@ -71,10 +89,11 @@ handle_new(struct arena *arena, struct handle_pool *handle_pool)
 	u32 index = handle_pool->len++;
 	handle_t handle = handle_pool->dense[index];
 
-	// increase generation
-	u32 gen = sm__handle_gen(handle);
+	// increase generation, skipping 0 on wrap around so index 0 never gives back INVALID_HANDLE
+	u32 gen = (u32)((sm__handle_gen(handle) + 1) & sm__handle_gen_mask);
+	gen += (gen == 0);
 	u32 _index = handle_index(handle);
-	handle_t new_handle = sm__handle_make(++gen, _index);
+	handle_t new_handle = sm__handle_make(gen, _index);
 
 	handle_pool->dense[index] = new_handle;
 	handle_pool->sparse[_index] = index;
@@ -101,11 +120,13 @@ b8
 handle_valid(const struct handle_pool *pool, handle_t handle)
 {
 	sm__assert(handle);
+	sm__assert(handle_index(handle) < pool->cap);
 
 	b8 result;
 
+	// sparse always points inside dense, so both tests can be evaluated without a branch
 	u32 index = pool->sparse[handle_index(handle)];
-	result = index < pool->len && pool->dense[index] == handle;
+	result = (index < pool->len) & (pool->dense[index] == handle);
 
 	return (result);
 }
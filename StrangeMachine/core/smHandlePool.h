@@ -4,7 +4,16 @@
 #include "core/smBase.h"
 #include "core/smCore.h"
 
+// A handle packs a generation above the index of its slot. The default 32-bit handle keeps 18 bits of index
+// (262144 live objects per pool) and 14 bits of generation. Building with SM_HANDLE_64 widens both to 32 bits for
+// scenes that need more objects or churn through slots fast enough to wrap the generation.
+#if defined(SM_HANDLE_64)
+typedef u64 handle_t;
+#	define CONFIG_HANDLE_GEN_BITS 32
+#else
 typedef u32 handle_t;
+#	define CONFIG_HANDLE_GEN_BITS 14
+#endif
 
 struct handle_pool
 {
@@ -15,22 +24,26 @@ struct handle_pool
 	array(u32) sparse;     // [0..capacity] saves indexes-to-dense for removal lookup
 };
 
-#define CONFIG_HANDLE_GEN_BITS 14
-#define INVALID_HANDLE	       0u
+#define CONFIG_HANDLE_BITS	 (sizeof(handle_t) * 8)
+#define CONFIG_HANDLE_INDEX_BITS (CONFIG_HANDLE_BITS - CONFIG_HANDLE_GEN_BITS)
+#define INVALID_HANDLE		 0u
 
-static const u32 sm__handle_index_mask = (1 << (32 - CONFIG_HANDLE_GEN_BITS)) - 1;
-static const u32 sm__handle_gen_mask = ((1 << CONFIG_HANDLE_GEN_BITS) - 1);
-static const u32 sm__handle_gen_shift = (32 - CONFIG_HANDLE_GEN_BITS);
+static const handle_t sm__handle_index_mask = ((handle_t)1 << CONFIG_HANDLE_INDEX_BITS) - 1;
+static const handle_t sm__handle_gen_mask = ((handle_t)1 << CONFIG_HANDLE_GEN_BITS) - 1;
+static const u32 sm__handle_gen_shift = CONFIG_HANDLE_INDEX_BITS;
 
 #define handle_index(HANDLE)   (u32)((HANDLE)&sm__handle_index_mask)
 #define sm__handle_gen(HANDLE) (u32)(((HANDLE) >> sm__handle_gen_shift) & sm__handle_gen_mask)
-#define sm__handle_make(GEN, INDEX) \
-	(u32)((((u32)(GEN)&sm__handle_gen_mask) << sm__handle_gen_shift) | ((u32)(INDEX)&sm__handle_index_mask))
+#define sm__handle_make(GEN, INDEX)                                                  \
+	(handle_t)((((handle_t)(GEN)&sm__handle_gen_mask) << sm__handle_gen_shift) | \
+		   ((handle_t)(INDEX)&sm__handle_index_mask))
 
 void handle_pool_make(struct arena *arena, struct handle_pool *handle_pool, u32 capacity);
 void handle_pool_release(struct arena *arena, struct handle_pool *handle_pool);
 void handle_pool_reset(struct handle_pool *pool);
 void handle_pool_copy(struct handle_pool *dest, struct handle_pool *src);
+// grows the pool once so that count more handles fit
+void handle_pool_reserve(struct arena *arena, struct handle_pool *handle_pool, u32 count);
 
 handle_t handle_new(struct arena *arena, struct handle_pool *handle_pool);
 void handle_remove(struct handle_pool *pool, handle_t handle);
@@ -18,11 +18,13 @@ struct FN(result)
 	GEN_VALUE_TYPE value;
 };
 
-static struct FN(entry_map) * FN(entry_ctor)(struct arena *arena, GEN_KEY_TYPE key, u32 hash, GEN_VALUE_TYPE value)
+#define MAP_ENTRIES_PER_PAGE 64
+
+static struct FN(entry_map) * FN(entry_ctor)(struct pool_allocator *pool, GEN_KEY_TYPE key, u32 hash, GEN_VALUE_TYPE value)
 {
 	struct FN(entry_map) * result;
 
-	result = arena_reserve(arena, sizeof(struct FN(entry_map)));
+	result = pool_alloc(pool);
 	// result = malloc(sizeof(struct FN(entry_map)));
 	result->key = key;
 	result->hash = hash;
@@ -37,9 +39,12 @@ struct FN(map)
 	struct FN(entry_map) * *entries;
 	u32 count;
 	u32 capcity;
+
+	struct pool_allocator entry_pool;
 };
 
 struct FN(map) FN(map_make)(struct arena *arena);
+void FN(map_release)(struct arena *arena, struct FN(map) * map);
 struct FN(result) FN(map_put)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key, GEN_VALUE_TYPE value);
 struct FN(result) FN(map_get)(struct FN(map) * map, GEN_KEY_TYPE key);
 struct FN(result) FN(map_remove)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key);
@@ -120,9 +125,21 @@ struct FN(map) FN(map_make)(struct arena *arena)
 	// result.entries = calloc(result.capcity, sizeof(struct FN(entry_map) *));
 	result.count = 0;
 
+	pool_allocator_make(&result.entry_pool, arena, sizeof(struct FN(entry_map)), MAP_ENTRIES_PER_PAGE);
+
 	return (result);
 }
 
+void
+FN(map_release)(struct arena *arena, struct FN(map) * map)
+{
+	// the entries live in the pool pages, they go back with it
+	pool_allocator_release(&map->entry_pool);
+	arena_free(arena, map->entries);
+
+	*map = (struct FN(map)){0};
+}
+
 struct FN(result) FN(map_put)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key, GEN_VALUE_TYPE value)
 {
 	struct FN(result) result = {0};
@@ -136,7 +153,7 @@ struct FN(result) FN(map_put)(struct arena *arena, struct FN(map) * map, GEN_KEY
 		struct FN(entry_map) *current = *entry;
 		if (current == 0)
 		{
-			*entry = FN(entry_ctor)(arena, key, hash, value);
+			*entry = FN(entry_ctor)(&map->entry_pool, key, hash, value);
 			map->count++;
 			FN(sm__expand_if_necessary)(arena, map);
 			return (result);
@@ -181,7 +198,7 @@ struct FN(result) FN(map_get)(struct FN(map) * map, GEN_KEY_TYPE key)
 	return (result);
 }
 
-struct FN(result) FN(map_remove)(struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key)
+struct FN(result) FN(map_remove)(sm__maybe_unused struct arena *arena, struct FN(map) * map, GEN_KEY_TYPE key)
 {
 	struct FN(result) result = {0};
 	u32 hash = FN(sm__hash_key)(key);
@@ -195,7 +212,7 @@ struct FN(result) FN(map_remove)(struct arena *arena, struct FN(map) * map, GEN_
 		{
 			GEN_VALUE_TYPE value = current->value;
 			*entry = current->next;
-			arena_free(arena, current);
+			pool_free(&map->entry_pool, current);
 			// free(current);
 			map->count--;
 
@@ -227,6 +244,7 @@ FN(for_each)(struct FN(map) * map, b32 (*cb)(GEN_KEY_TYPE key, GEN_VALUE_TYPE va
 	}
 }
 
+#undef MAP_ENTRIES_PER_PAGE
 #undef _CAT3
 #undef CAT3
 #undef FN
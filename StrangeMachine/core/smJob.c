@@ -0,0 +1,316 @@
+#include "core/smBase.h"
+
+#include "core/smCore.h"
+#include "core/smLog.h"
+#include "core/smThread.h"
+
+// Every thread taking part owns a Chase-Lev deque: the main thread owns deque 0 and worker i owns deque i. The owner
+// pushes and pops at the bottom without synchronizing with anyone unless a single job is left, other threads steal
+// from the top with a compare and swap. Workers that find nothing to run, after spinning for a while, sleep on a
+// semaphore that job_submit posts when it knows somebody is sleeping.
+
+#define JOB_DEQUE_CAPACITY 1024 // jobs per thread, power of two. A submit that finds its deque full runs the job inline
+#define JOB_DEQUE_MASK	   (JOB_DEQUE_CAPACITY - 1)
+#define JOB_SPIN_COUNT	   64
+#define JOB_CACHE_LINE	   64
+
+struct sm__job
+{
+	job_f fn;
+	void *user_data;
+	struct job_counter *counter;
+	u32 index;
+};
+
+struct sm__job_deque
+{
+	atomic_llong top; // stolen from here
+	u8 __pad0[JOB_CACHE_LINE - sizeof(atomic_llong)];
+
+	atomic_llong bottom; // pushed and popped here, written by the owner only
+	u8 __pad1[JOB_CACHE_LINE - sizeof(atomic_llong)];
+
+	struct sm__job *jobs;
+	u8 __pad2[JOB_CACHE_LINE - sizeof(struct sm__job *)];
+};
+
+struct job_system
+{
+	u32 worker_count;
+	struct thread *threads[JOB_MAX_WORKERS];
+	i8 names[JOB_MAX_WORKERS][16];
+	struct sm__job_deque *deques; // worker_count + 1
+
+	atomic_int sleepers;
+	atomic_bool running;
+	struct semaphore wake;
+
+	struct arena arena;
+};
+
+static struct job_system JC; // Job Context
+
+// 1 + index of the deque owned by the thread, 0 when the thread does not take part in the job system
+static _Thread_local u32 sm__job_thread_slot;
+
+static b8
+sm__job_deque_push(struct sm__job_deque *deque, const struct sm__job *job)
+{
+	i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+
+	if (bottom - top >= JOB_DEQUE_CAPACITY) { return (false); }
+
+	deque->jobs[bottom & JOB_DEQUE_MASK] = *job;
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_release);
+
+	return (true);
+}
+
+static b8
+sm__job_deque_pop(struct sm__job_deque *deque, struct sm__job *job)
+{
+	b8 result = false;
+
+	i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	i64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+	if (top <= bottom)
+	{
+		*job = deque->jobs[bottom & JOB_DEQUE_MASK];
+		result = true;
+
+		if (top == bottom)
+		{
+			// last job, race the thieves for it
+			if (!atomic_compare_exchange_strong_explicit(
+				&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+			{
+				result = false;
+			}
+			atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+		}
+	}
+	else { atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed); }
+
+	return (result);
+}
+
+static b8
+sm__job_deque_steal(struct sm__job_deque *deque, struct sm__job *job)
+{
+	b8 result = false;
+
+	i64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	i64 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+	if (top < bottom)
+	{
+		// the copy can race with the owner reusing the slot when top is already stale, the compare and swap fails
+		// in that case and the copy is thrown away
+		*job = deque->jobs[top & JOB_DEQUE_MASK];
+		result = atomic_compare_exchange_strong_explicit(
+		    &deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+	}
+
+	return (result);
+}
+
+static void
+sm__job_run(struct sm__job *job)
+{
+	job->fn(job->user_data, job->index);
+	atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+}
+
+// own deque first, then every other deque starting at a random one
+static b8
+sm__job_find(u32 slot, u32 *rng, struct sm__job *job)
+{
+	if (sm__job_deque_pop(&JC.deques[slot], job)) { return (true); }
+
+	u32 deque_count = JC.worker_count + 1;
+
+	*rng ^= *rng << 13;
+	*rng ^= *rng >> 17;
+	*rng ^= *rng << 5;
+
+	u32 start = *rng % deque_count;
+	for (u32 i = 0; i < deque_count; ++i)
+	{
+		u32 victim = (start + i) % deque_count;
+		if (victim == slot) { continue; }
+
+		if (sm__job_deque_steal(&JC.deques[victim], job)) { return (true); }
+	}
+
+	return (false);
+}
+
+static i32
+sm__job_worker_main(void *user_data1, sm__maybe_unused void *user_data2)
+{
+	u32 slot = (u32)(uintptr_t)user_data1;
+	u32 rng = 0x9e3779b9u * (slot + 1);
+
+	sm__job_thread_slot = slot + 1;
+
+	struct sm__job job;
+	while (atomic_load_explicit(&JC.running, memory_order_acquire))
+	{
+		b8 found = false;
+		for (u32 spin = 0; spin < JOB_SPIN_COUNT && !found; ++spin)
+		{
+			found = sm__job_find(slot, &rng, &job);
+			if (!found) { thread_yield(); }
+		}
+
+		if (!found)
+		{
+			// announce the nap before looking one last time, a submit racing with us either sees the sleeper or
+			// pushed its jobs early enough for this search to find them
+			atomic_fetch_add(&JC.sleepers, 1);
+			found = sm__job_find(slot, &rng, &job);
+			if (!found && atomic_load(&JC.running)) { sync_semaphore_wait(&JC.wake, -1); }
+			atomic_fetch_sub(&JC.sleepers, 1);
+		}
+
+		if (found) { sm__job_run(&job); }
+	}
+
+	return (0);
+}
+
+b8
+job_system_init(u32 worker_count)
+{
+	sm__assert(JC.deques == 0);
+
+	worker_count = MIN(worker_count, JOB_MAX_WORKERS);
+
+	u32 deque_count = worker_count + 1;
+	u32 deques_size = deque_count * (sizeof(struct sm__job_deque) + JOB_DEQUE_CAPACITY * sizeof(struct sm__job));
+
+	struct buf m_jobs = base_memory_reserve(deques_size + JOB_CACHE_LINE);
+	if (m_jobs.data == 0) { return (false); }
+
+	u8 *cursor = (u8 *)(((uintptr_t)m_jobs.data + (JOB_CACHE_LINE - 1)) & ~(uintptr_t)(JOB_CACHE_LINE - 1));
+	JC.deques = (struct sm__job_deque *)cursor;
+	cursor += deque_count * sizeof(struct sm__job_deque);
+	for (u32 i = 0; i < deque_count; ++i)
+	{
+		atomic_store(&JC.deques[i].top, 0);
+		atomic_store(&JC.deques[i].bottom, 0);
+		JC.deques[i].jobs = (struct sm__job *)cursor;
+		cursor += JOB_DEQUE_CAPACITY * sizeof(struct sm__job);
+	}
+
+	arena_make(&JC.arena, base_memory_reserve(KB(16)));
+	arena_set_name(&JC.arena, str8_from("jobs"));
+
+	JC.worker_count = worker_count;
+	atomic_store(&JC.sleepers, 0);
+	atomic_store(&JC.running, true);
+	sync_semaphore_init(&JC.wake);
+
+	// the calling thread (main) owns the first deque
+	sm__job_thread_slot = 1;
+
+	for (u32 i = 0; i < worker_count; ++i)
+	{
+		i32 len = snprintf(JC.names[i], sizeof(JC.names[i]), "sm worker %u", i + 1);
+		JC.threads[i] = thread_create(&JC.arena, sm__job_worker_main, (void *)(uintptr_t)(i + 1), KB(256),
+		    (str8){.idata = JC.names[i], .size = (u32)len}, 0);
+	}
+
+	log_info(str8_from("job system: {u3d} workers"), worker_count);
+
+	return (true);
+}
+
+void
+job_system_teardown(void)
+{
+	if (JC.deques == 0) { return; }
+
+	atomic_store(&JC.running, false);
+	sync_semaphore_post(&JC.wake, (i32)JC.worker_count);
+
+	for (u32 i = 0; i < JC.worker_count; ++i) { thread_destroy(JC.threads[i], &JC.arena); }
+
+	sync_semaphore_release(&JC.wake);
+	arena_release(&JC.arena);
+
+	sm__job_thread_slot = 0;
+	JC = (struct job_system){0};
+}
+
+struct job_system *
+job_system_get(void)
+{
+	struct job_system *result = 0;
+
+	if (JC.deques && JC.worker_count > 0) { result = &JC; }
+
+	return (result);
+}
+
+u32
+job_thread_count(struct job_system *jobs)
+{
+	u32 result = 1;
+
+	if (jobs) { result += jobs->worker_count; }
+
+	return (result);
+}
+
+u32
+job_thread_index(void)
+{
+	u32 result = sm__job_thread_slot ? sm__job_thread_slot - 1 : 0;
+
+	return (result);
+}
+
+void
+job_submit(struct job_system *jobs, struct job_counter *counter, job_f fn, void *user_data, u32 count)
+{
+	u32 slot = sm__job_thread_slot;
+	if (jobs == 0 || slot == 0)
+	{
+		for (u32 i = 0; i < count; ++i) { fn(user_data, i); }
+		return;
+	}
+
+	atomic_fetch_add_explicit(&counter->pending, count, memory_order_relaxed);
+
+	struct sm__job_deque *deque = &jobs->deques[slot - 1];
+	for (u32 i = 0; i < count; ++i)
+	{
+		struct sm__job job = {.fn = fn, .user_data = user_data, .counter = counter, .index = i};
+		if (!sm__job_deque_push(deque, &job)) { sm__job_run(&job); }
+	}
+
+	// pairs with the increment of sleepers in sm__job_worker_main
+	atomic_thread_fence(memory_order_seq_cst);
+	i32 sleepers = atomic_load_explicit(&jobs->sleepers, memory_order_relaxed);
+	if (sleepers > 0) { sync_semaphore_post(&jobs->wake, MIN(sleepers, (i32)count)); }
+}
+
+void
+job_wait(struct job_system *jobs, struct job_counter *counter)
+{
+	u32 slot = sm__job_thread_slot;
+	u32 rng = 0x85ebca6bu * (slot + 1);
+
+	struct sm__job job;
+	while (atomic_load_explicit(&counter->pending, memory_order_acquire) != 0)
+	{
+		if (jobs && slot && sm__job_find(slot - 1, &rng, &job)) { sm__job_run(&job); }
+		else { thread_yield(); }
+	}
+}
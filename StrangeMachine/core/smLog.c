@@ -16,6 +16,7 @@ log_init(void)
 	struct buf m_log = base_memory_reserve(KB(10));
 
 	arena_make(&LC.arena, m_log);
+	arena_set_name(&LC.arena, str8_from("log"));
 
 	return (true);
 }
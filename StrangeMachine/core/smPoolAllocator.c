@@ -0,0 +1,102 @@
+#include "core/smBase.h"
+#include "core/smCore.h"
+#include "core/smLog.h"
+
+#define POOL_ALLOCATOR_ALIGN 16
+
+struct sm__pool_page
+{
+	struct sm__pool_page *next;
+};
+
+struct sm__pool_block
+{
+	struct sm__pool_block *next;
+};
+
+#define sm__pool_page_header_size ((sizeof(struct sm__pool_page) + POOL_ALLOCATOR_ALIGN - 1) & ~(POOL_ALLOCATOR_ALIGN - 1))
+
+void
+sm__pool_allocator_make(struct pool_allocator *pool, struct arena *arena, u32 block_size, u32 blocks_per_page,
+    sm__maybe_unused str8 file, sm__maybe_unused u32 line)
+{
+	sm__assert(arena);
+	sm__assert(blocks_per_page > 0);
+
+	block_size = MAX(block_size, (u32)sizeof(struct sm__pool_block));
+	block_size = (block_size + (sizeof(void *) - 1)) & ~(u32)(sizeof(void *) - 1);
+
+	pool->arena = arena;
+	pool->block_size = block_size;
+	pool->blocks_per_page = blocks_per_page;
+	pool->free_list = 0;
+	pool->pages = 0;
+	pool->used = 0;
+	pool->capacity = 0;
+}
+
+void
+sm__pool_allocator_release(struct pool_allocator *pool, str8 file, u32 line)
+{
+	struct sm__pool_page *page = pool->pages;
+	while (page)
+	{
+		struct sm__pool_page *next = page->next;
+		sm__arena_free(pool->arena, page, file, line);
+		page = next;
+	}
+
+	*pool = (struct pool_allocator){0};
+}
+
+static void
+sm__pool_allocator_grow(struct pool_allocator *pool, str8 file, u32 line)
+{
+	u32 page_size = (u32)sm__pool_page_header_size + pool->block_size * pool->blocks_per_page;
+
+	struct sm__pool_page *page = sm__arena_aligned(pool->arena, POOL_ALLOCATOR_ALIGN, page_size, file, line);
+	page->next = pool->pages;
+	pool->pages = page;
+
+	// thread the new blocks in address order so consecutive allocations are contiguous
+	u8 *blocks = (u8 *)page + sm__pool_page_header_size;
+	for (u32 i = 0; i < pool->blocks_per_page; ++i)
+	{
+		struct sm__pool_block *block = (struct sm__pool_block *)(blocks + i * pool->block_size);
+		block->next = (i + 1 < pool->blocks_per_page)
+				  ? (struct sm__pool_block *)(blocks + (i + 1) * pool->block_size)
+				  : pool->free_list;
+	}
+
+	pool->free_list = blocks;
+	pool->capacity += pool->blocks_per_page;
+}
+
+void *
+sm__pool_allocator_alloc(struct pool_allocator *pool, str8 file, u32 line)
+{
+	void *result = 0;
+
+	if (pool->free_list == 0) { sm__pool_allocator_grow(pool, file, line); }
+
+	struct sm__pool_block *block = pool->free_list;
+	pool->free_list = block->next;
+	pool->used++;
+
+	result = block;
+
+	return (result);
+}
+
+void
+sm__pool_allocator_free(struct pool_allocator *pool, void *ptr, sm__maybe_unused str8 file, sm__maybe_unused u32 line)
+{
+	if (ptr == 0) { return; }
+
+	sm__assert(pool->used > 0);
+
+	struct sm__pool_block *block = ptr;
+	block->next = pool->free_list;
+	pool->free_list = block;
+	pool->used--;
+}
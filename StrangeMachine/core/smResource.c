@@ -25,12 +25,13 @@
 #define GEN_VALUE_TYPE		       struct resource *
 #define GEN_HASH_KEY_FN(_key)	       str8_hash(_key)
 #define GEN_CMP_KEY_FN(_key_a, _key_b) str8_eq(_key_a, _key_b)
-#include "core/smHashMap.inl"
+#include "core/smFlatHashMap.inl"
 
 struct resource_manager
 {
 	struct arena arena;
 
+	struct rwlock map_lock; // label lookups take it shared, pushing a resource takes it exclusive
 	struct str8_resource_map map;
 	usize resource_count;
 	array(struct resource) resources;
@@ -300,7 +301,7 @@ resource_trace(struct resource *resource)
 	if (resource_tracer[resource->type])
 	{
 		log_trace(str8_from("============| {s} |============"), resource_str8[resource->type]);
-		log_trace(str8_from(" * slot id    : {u3d}"), resource->slot.id);
+		log_trace(str8_from(" * slot id    : {u6d}"), (u64)resource->slot.id);
 		log_trace(str8_from(" * slot status: {s}"), resource_state_str8[resource->slot.state]);
 		log_trace(str8_from(" * slot ref   : 0x{u6x}"), resource->slot.ref);
 		log_trace(str8_from(" * name       : {s}"), resource->label);
@@ -654,11 +655,12 @@ sm__resource_prefetch(struct resource *resource)
 #define RESOURCE_INITIAL_CAPACITY_TEXTS	    32
 
 b32
-resource_manager_init(i8 *argv[], str8 assets_folder)
+resource_manager_init(i8 *argv[], str8 assets_folder, u32 budget)
 {
-	struct buf m_resource = base_memory_reserve(MB(15));
+	struct buf m_resource = base_memory_reserve(budget);
 
 	arena_make(&RC.arena, m_resource);
+	arena_set_name(&RC.arena, str8_from("resource"));
 	arena_validate(&RC.arena);
 
 	// clang-format off
@@ -721,6 +723,7 @@ resource_manager_init(i8 *argv[], str8 assets_folder)
 		return (0);
 	}
 
+	sync_rwlock_init(&RC.map_lock);
 	RC.map = str8_resource_map_make(&RC.arena);
 
 	// sm__resource_manager_load_defaults();
@@ -801,6 +804,7 @@ resource_push(struct resource *resource)
 		return (result);
 	}
 
+	sync_rwlock_write_enter(&RC.map_lock);
 	sm__assert(RC.resource_count < RESOURCE_INITIAL_CAPACITY_RESOURCES);
 
 	RC.resources[RC.resource_count++] = *resource;
@@ -808,6 +812,7 @@ resource_push(struct resource *resource)
 	result->slot.ref = result;
 
 	struct str8_resource_result result_map = str8_resource_map_put(&RC.arena, &RC.map, result->label, result);
+	sync_rwlock_write_exit(&RC.map_lock);
 	if (result_map.ok)
 	{
 		log_error(str8_from("[{s}] duplicated resource!"), resource->label);
@@ -822,7 +827,9 @@ resource_get_by_label(str8 name)
 {
 	struct resource *result = 0;
 
+	sync_rwlock_read_enter(&RC.map_lock);
 	struct str8_resource_result result_map = str8_resource_map_get(&RC.map, name);
+	sync_rwlock_read_exit(&RC.map_lock);
 	if (!result_map.ok)
 	{
 		log_warn(str8_from("[{s}] resource not found"), name);
@@ -842,7 +849,9 @@ resource_get_by_label(str8 name)
 void
 resource_for_each(b32 (*cb)(str8, struct resource *, void *), void *user_data)
 {
+	sync_rwlock_read_enter(&RC.map_lock);
 	str8_resource_for_each(&RC.map, cb, user_data);
+	sync_rwlock_read_exit(&RC.map_lock);
 }
 
 struct arena *
@@ -3275,6 +3284,7 @@ sm___resource_mock_init(i8 *argv[], str8 mount_directory)
 {
 	struct buf m_resource = base_memory_reserve(MB(30));
 	arena_make(&RC.arena, m_resource);
+	arena_set_name(&RC.arena, str8_from("resource"));
 	arena_validate(&RC.arena);
 
 	// clang-format off
@@ -3337,6 +3347,7 @@ sm___resource_mock_init(i8 *argv[], str8 mount_directory)
 		return (0);
 	}
 
+	sync_rwlock_init(&RC.map_lock);
 	RC.map = str8_resource_map_make(&RC.arena);
 
 	// sm__resource_manager_load_defaults();
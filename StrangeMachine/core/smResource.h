@@ -79,6 +79,7 @@ struct resource *resource_push(struct resource *resource);
 struct resource *resource_get_by_label(str8 name);
 void resource_trace(struct resource *resource);
 void resource_write(struct resource *resource);
+// cb runs with the label map locked for reading, it must not push resources
 void resource_for_each(b32 (*cb)(str8, struct resource *, void *), void *user_data);
 
 struct resource *resource_get_default_image(void);
@@ -14,12 +14,12 @@ static u8 str_buffer_data[1];
 static struct dyn_buf str_buffer =
     (struct dyn_buf){.data = str_buffer_data, .cap = ARRAY_SIZE(str_buffer_data), .len = 0};
 
-static struct mutex str8_mutex;
+static struct lock str8_lock;
 
 b8
 str8_init(void)
 {
-	sync_mutex_init(&str8_mutex);
+	sync_lock_init(&str8_lock);
 
 	return (true);
 }
@@ -27,19 +27,18 @@ str8_init(void)
 void
 str8_teardown(void)
 {
-	sync_mutex_release(&str8_mutex);
 }
 
 void
 str8_buffer_flush(void)
 {
-	sync_mutex_lock(&str8_mutex);
+	sync_lock_enter(&str8_lock);
 	if (str_buffer.len > 0)
 	{
 		write(1, str_buffer.data, str_buffer.len);
 		str_buffer.len = 0;
 	}
-	sync_mutex_unlock(&str8_mutex);
+	sync_lock_exit(&str8_lock);
 }
 
 static void
@@ -55,10 +54,10 @@ sm__buffer_push(str8 str)
 	}
 	else
 	{
-		sync_mutex_lock(&str8_mutex);
+		sync_lock_enter(&str8_lock);
 		memcpy(str_buffer.data + str_buffer.len, str.data, str.size);
 		str_buffer.len += str.size;
-		sync_mutex_unlock(&str8_mutex);
+		sync_lock_exit(&str8_lock);
 	}
 }
 
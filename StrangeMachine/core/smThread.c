@@ -249,6 +249,7 @@ thread_fn(void *arg)
 
 	sync_semaphore_post(&thrd->sem, 1);
 	cast.i = thrd->callback(thrd->user_data1, thrd->user_data2);
+	arena_thread_cache_flush();
 	return cast.ptr;
 }
 
@@ -343,6 +344,13 @@ thread_yield(void)
 	sched_yield();
 }
 
+u32
+thread_hardware_concurrency(void)
+{
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (u32)count : 1;
+}
+
 // Mutex
 void
 sync_mutex_init(struct mutex *mutex)
@@ -666,7 +674,9 @@ thread_fn(LPVOID arg)
 	struct thread *thrd = (struct thread *)arg;
 	thrd->thread_id = GetCurrentThreadId();
 	sync_semaphore_post(&thrd->sem, 1);
-	return (DWORD)thrd->callback(thrd->user_data1, thrd->user_data2);
+	DWORD result = (DWORD)thrd->callback(thrd->user_data1, thrd->user_data2);
+	arena_thread_cache_flush();
+	return result;
 }
 
 struct thread *
@@ -728,6 +738,14 @@ thread_yield()
 	SwitchToThread();
 }
 
+u32
+thread_hardware_concurrency(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (u32)info.dwNumberOfProcessors;
+}
+
 #	pragma pack(push, 8)
 
 struct _ThreadName
@@ -786,3 +804,503 @@ thread_tid(void)
 	sm__assertf(0, "Tid not implemented");
 #endif // SM_PLATFORM_
 }
+
+// Queues
+
+#define SYNC_QUEUE_CACHE_LINE 64
+
+static u32
+sm__sync_queue_capacity(u32 capacity)
+{
+	sm__assert(capacity > 0 && capacity <= (1u << 31));
+
+	u32 result = 2;
+	while (result < capacity) { result <<= 1; }
+
+	return (result);
+}
+
+// copies count items into the ring starting at the unmasked index, wrapping around the end of the buffer
+static void
+sm__sync_queue_write(u8 *buffer, u32 mask, u32 item_size, u32 index, const u8 *data, u32 count)
+{
+	u32 first = index & mask;
+	u32 n = MIN(count, mask + 1 - first);
+
+	memcpy(buffer + first * item_size, data, n * item_size);
+	memcpy(buffer, data + n * item_size, (count - n) * item_size);
+}
+
+static void
+sm__sync_queue_read(const u8 *buffer, u32 mask, u32 item_size, u32 index, u8 *data, u32 count)
+{
+	u32 first = index & mask;
+	u32 n = MIN(count, mask + 1 - first);
+
+	memcpy(data, buffer + first * item_size, n * item_size);
+	memcpy(data + n * item_size, buffer, (count - n) * item_size);
+}
+
+// Head and tail are free running counters, the slot is the counter masked by the capacity. The producer only
+// writes tail and the consumer only writes head. Each side keeps a copy of the other index on its own cache line and
+// reloads it only when the copy says the queue is full or empty.
+struct queue_spsc
+{
+	atomic_uint tail;
+	u32 head_cache; // producer side
+	u8 __pad0[SYNC_QUEUE_CACHE_LINE - 2 * sizeof(u32)];
+
+	atomic_uint head;
+	u32 tail_cache; // consumer side
+	u8 __pad1[SYNC_QUEUE_CACHE_LINE - 2 * sizeof(u32)];
+
+	u32 mask;
+	u32 item_size;
+	u8 *buffer;
+};
+
+struct queue_spsc *
+sync_queue_spsc_create(struct arena *arena, u32 item_size, u32 capacity)
+{
+	sm__assert(item_size > 0);
+
+	capacity = sm__sync_queue_capacity(capacity);
+
+	u32 header_size = (sizeof(struct queue_spsc) + (SYNC_QUEUE_CACHE_LINE - 1)) & ~(SYNC_QUEUE_CACHE_LINE - 1);
+	u8 *data = arena_aligned(arena, SYNC_QUEUE_CACHE_LINE, header_size + capacity * item_size);
+
+	struct queue_spsc *result = (struct queue_spsc *)data;
+	memset(result, 0x0, sizeof(struct queue_spsc));
+
+	atomic_init(&result->tail, 0);
+	atomic_init(&result->head, 0);
+	result->mask = capacity - 1;
+	result->item_size = item_size;
+	result->buffer = data + header_size;
+
+	return (result);
+}
+
+void
+sync_queue_spsc_destroy(struct queue_spsc *queue, struct arena *arena)
+{
+	arena_free(arena, queue);
+}
+
+u32
+sync_queue_spsc_produce_n(struct queue_spsc *queue, const void *data, u32 count)
+{
+	u32 capacity = queue->mask + 1;
+	u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+
+	u32 free = capacity - (tail - queue->head_cache);
+	if (free < count)
+	{
+		queue->head_cache = atomic_load_explicit(&queue->head, memory_order_acquire);
+		free = capacity - (tail - queue->head_cache);
+	}
+
+	u32 result = MIN(count, free);
+	if (result)
+	{
+		sm__sync_queue_write(queue->buffer, queue->mask, queue->item_size, tail, data, result);
+		atomic_store_explicit(&queue->tail, tail + result, memory_order_release);
+	}
+
+	return (result);
+}
+
+u32
+sync_queue_spsc_consume_n(struct queue_spsc *queue, void *data, u32 count)
+{
+	u32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+
+	u32 available = queue->tail_cache - head;
+	if (available < count)
+	{
+		queue->tail_cache = atomic_load_explicit(&queue->tail, memory_order_acquire);
+		available = queue->tail_cache - head;
+	}
+
+	u32 result = MIN(count, available);
+	if (result)
+	{
+		sm__sync_queue_read(queue->buffer, queue->mask, queue->item_size, head, data, result);
+		atomic_store_explicit(&queue->head, head + result, memory_order_release);
+	}
+
+	return (result);
+}
+
+b8
+sync_queue_spsc_produce(struct queue_spsc *queue, const void *data)
+{
+	return (sync_queue_spsc_produce_n(queue, data, 1) == 1);
+}
+
+b8
+sync_queue_spsc_consume(struct queue_spsc *queue, void *data)
+{
+	return (sync_queue_spsc_consume_n(queue, data, 1) == 1);
+}
+
+// producer side only
+b8
+sync_queue_spsc_full(struct queue_spsc *queue)
+{
+	u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+	u32 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+	return (tail - head == queue->mask + 1);
+}
+
+// Bounded MPMC queue from Dmitry Vyukov. Every slot carries a sequence number telling which lap of the ring it is
+// ready for: a slot at position pos is free for a producer when its sequence is pos and holds an item for a consumer
+// when it is pos + 1. Producers and consumers claim runs of ready slots with a single compare and swap on their
+// position, then fill or drain them and publish each slot through its sequence.
+struct queue_mpmc
+{
+	atomic_uint enqueue_pos;
+	u8 __pad0[SYNC_QUEUE_CACHE_LINE - sizeof(atomic_uint)];
+
+	atomic_uint dequeue_pos;
+	u8 __pad1[SYNC_QUEUE_CACHE_LINE - sizeof(atomic_uint)];
+
+	u32 mask;
+	u32 item_size;
+	atomic_uint *sequence;
+	u8 *buffer;
+};
+
+struct queue_mpmc *
+sync_queue_mpmc_create(struct arena *arena, u32 item_size, u32 capacity)
+{
+	sm__assert(item_size > 0);
+
+	capacity = sm__sync_queue_capacity(capacity);
+
+	u32 header_size = (sizeof(struct queue_mpmc) + (SYNC_QUEUE_CACHE_LINE - 1)) & ~(SYNC_QUEUE_CACHE_LINE - 1);
+	u32 sequence_size = capacity * sizeof(atomic_uint);
+	u8 *data = arena_aligned(arena, SYNC_QUEUE_CACHE_LINE, header_size + sequence_size + capacity * item_size);
+
+	struct queue_mpmc *result = (struct queue_mpmc *)data;
+	memset(result, 0x0, sizeof(struct queue_mpmc));
+
+	atomic_init(&result->enqueue_pos, 0);
+	atomic_init(&result->dequeue_pos, 0);
+	result->mask = capacity - 1;
+	result->item_size = item_size;
+	result->sequence = (atomic_uint *)(data + header_size);
+	result->buffer = data + header_size + sequence_size;
+
+	for (u32 i = 0; i < capacity; ++i) { atomic_init(&result->sequence[i], i); }
+
+	return (result);
+}
+
+void
+sync_queue_mpmc_destroy(struct queue_mpmc *queue, struct arena *arena)
+{
+	arena_free(arena, queue);
+}
+
+// claims up to count consecutive slots whose sequence is pos + i + lap, returns the first position through pos
+static u32
+sm__sync_queue_mpmc_claim(struct queue_mpmc *queue, atomic_uint *position, u32 lap, u32 count, u32 *pos)
+{
+	if (count == 0) { return (0); }
+
+	u32 current = atomic_load_explicit(position, memory_order_relaxed);
+
+	while (true)
+	{
+		u32 n = 0;
+		i32 diff = 0;
+		for (; n < count; ++n)
+		{
+			u32 seq = atomic_load_explicit(&queue->sequence[(current + n) & queue->mask], memory_order_acquire);
+			diff = (i32)(seq - (current + n + lap));
+			if (diff != 0) { break; }
+		}
+
+		if (n > 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(
+				position, &current, current + n, memory_order_relaxed, memory_order_relaxed))
+			{
+				*pos = current;
+				return (n);
+			}
+		}
+		// the first slot is a lap behind: full for producers, empty for consumers
+		else if (diff < 0) { return (0); }
+		// somebody else moved the position past us
+		else { current = atomic_load_explicit(position, memory_order_relaxed); }
+	}
+}
+
+u32
+sync_queue_mpmc_produce_n(struct queue_mpmc *queue, const void *data, u32 count)
+{
+	u32 pos;
+	u32 result = sm__sync_queue_mpmc_claim(queue, &queue->enqueue_pos, 0, count, &pos);
+
+	if (result)
+	{
+		sm__sync_queue_write(queue->buffer, queue->mask, queue->item_size, pos, data, result);
+		for (u32 i = 0; i < result; ++i)
+		{
+			atomic_store_explicit(&queue->sequence[(pos + i) & queue->mask], pos + i + 1, memory_order_release);
+		}
+	}
+
+	return (result);
+}
+
+u32
+sync_queue_mpmc_consume_n(struct queue_mpmc *queue, void *data, u32 count)
+{
+	u32 pos;
+	u32 result = sm__sync_queue_mpmc_claim(queue, &queue->dequeue_pos, 1, count, &pos);
+
+	if (result)
+	{
+		sm__sync_queue_read(queue->buffer, queue->mask, queue->item_size, pos, data, result);
+		for (u32 i = 0; i < result; ++i)
+		{
+			atomic_store_explicit(
+			    &queue->sequence[(pos + i) & queue->mask], pos + i + queue->mask + 1, memory_order_release);
+		}
+	}
+
+	return (result);
+}
+
+b8
+sync_queue_mpmc_produce(struct queue_mpmc *queue, const void *data)
+{
+	return (sync_queue_mpmc_produce_n(queue, data, 1) == 1);
+}
+
+b8
+sync_queue_mpmc_consume(struct queue_mpmc *queue, void *data)
+{
+	return (sync_queue_mpmc_consume_n(queue, data, 1) == 1);
+}
+
+// Lock
+
+#define SYNC_LOCK_SPIN_COUNT 128
+
+#define RWLOCK_WRITER	      (1u << 31)
+#define RWLOCK_WRITER_WAITING (1u << 30)
+
+#if defined(__x86_64__) || defined(__i386__)
+#	define sm__cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#	define sm__cpu_relax() __asm__ __volatile__("yield")
+#else
+#	define sm__cpu_relax() ((void)0)
+#endif
+
+#if SM_PLATFORM_LINUX || SM_PLATFORM_RPI
+#	include <linux/futex.h>
+
+// sleeps only if *addr still holds expected, spurious wake ups are fine, every caller loops
+static void
+sm__futex_wait(atomic_uint *addr, u32 expected)
+{
+	syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void
+sm__futex_wake(atomic_uint *addr, i32 count)
+{
+	syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+#else
+static void
+sm__futex_wait(sm__maybe_unused atomic_uint *addr, sm__maybe_unused u32 expected)
+{
+	thread_yield();
+}
+
+static void
+sm__futex_wake(sm__maybe_unused atomic_uint *addr, sm__maybe_unused i32 count)
+{
+}
+#endif
+
+void
+sync_lock_init(struct lock *lock)
+{
+	atomic_init(&lock->state, 0);
+	atomic_init(&lock->contended, 0);
+	atomic_init(&lock->parked, 0);
+}
+
+b8
+sync_lock_try(struct lock *lock)
+{
+	u32 expected = 0;
+	return (atomic_compare_exchange_strong_explicit(
+	    &lock->state, &expected, 1, memory_order_acquire, memory_order_relaxed));
+}
+
+// Drepper's futex mutex: whoever gives up spinning moves the state to 2, so the thread that unlocks knows it has to
+// wake somebody. An uncontended enter/exit pair is one compare and swap and one exchange, no system call.
+void
+sync_lock_enter(struct lock *lock)
+{
+	if (sync_lock_try(lock)) { return; }
+
+	atomic_fetch_add_explicit(&lock->contended, 1, memory_order_relaxed);
+
+	for (u32 spin = 0; spin < SYNC_LOCK_SPIN_COUNT; ++spin)
+	{
+		sm__cpu_relax();
+		if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0 && sync_lock_try(lock)) { return; }
+	}
+
+	while (atomic_exchange_explicit(&lock->state, 2, memory_order_acquire) != 0)
+	{
+		atomic_fetch_add_explicit(&lock->parked, 1, memory_order_relaxed);
+		sm__futex_wait(&lock->state, 2);
+	}
+}
+
+void
+sync_lock_exit(struct lock *lock)
+{
+	if (atomic_exchange_explicit(&lock->state, 0, memory_order_release) == 2) { sm__futex_wake(&lock->state, 1); }
+}
+
+struct lock_stats
+sync_lock_stats(struct lock *lock)
+{
+	struct lock_stats result;
+
+	result.contended = atomic_load_explicit(&lock->contended, memory_order_relaxed);
+	result.parked = atomic_load_explicit(&lock->parked, memory_order_relaxed);
+
+	return (result);
+}
+
+void
+sync_rwlock_init(struct rwlock *lock)
+{
+	atomic_init(&lock->state, 0);
+	atomic_init(&lock->waiters, 0);
+	atomic_init(&lock->contended, 0);
+	atomic_init(&lock->parked, 0);
+}
+
+// waiters and state are both sequentially consistent: either the thread changing the state sees the waiter, or the
+// futex sees the new state and does not sleep
+static void
+sm__rwlock_park(struct rwlock *lock, u32 state)
+{
+	atomic_fetch_add_explicit(&lock->parked, 1, memory_order_relaxed);
+	atomic_fetch_add(&lock->waiters, 1);
+	sm__futex_wait(&lock->state, state);
+	atomic_fetch_sub(&lock->waiters, 1);
+}
+
+static void
+sm__rwlock_wake(struct rwlock *lock)
+{
+	if (atomic_load(&lock->waiters) > 0) { sm__futex_wake(&lock->state, INT32_MAX); }
+}
+
+void
+sync_rwlock_read_enter(struct rwlock *lock)
+{
+	b8 contended = false;
+	u32 spin = 0;
+
+	while (true)
+	{
+		u32 state = atomic_load_explicit(&lock->state, memory_order_relaxed);
+		if ((state & (RWLOCK_WRITER | RWLOCK_WRITER_WAITING)) == 0)
+		{
+			if (atomic_compare_exchange_weak_explicit(
+				&lock->state, &state, state + 1, memory_order_acquire, memory_order_relaxed))
+			{
+				return;
+			}
+			continue;
+		}
+
+		if (!contended)
+		{
+			atomic_fetch_add_explicit(&lock->contended, 1, memory_order_relaxed);
+			contended = true;
+		}
+
+		if (spin++ < SYNC_LOCK_SPIN_COUNT) { sm__cpu_relax(); }
+		else { sm__rwlock_park(lock, state); }
+	}
+}
+
+void
+sync_rwlock_read_exit(struct rwlock *lock)
+{
+	u32 state = atomic_fetch_sub(&lock->state, 1) - 1;
+
+	// last reader out while a writer waits
+	if (state == RWLOCK_WRITER_WAITING) { sm__rwlock_wake(lock); }
+}
+
+void
+sync_rwlock_write_enter(struct rwlock *lock)
+{
+	b8 contended = false;
+	u32 spin = 0;
+
+	while (true)
+	{
+		u32 state = atomic_load_explicit(&lock->state, memory_order_relaxed);
+		if ((state & ~RWLOCK_WRITER_WAITING) == 0)
+		{
+			// clears the waiting bit too, the other waiting writers set it again when they wake up
+			if (atomic_compare_exchange_weak_explicit(
+				&lock->state, &state, RWLOCK_WRITER, memory_order_acquire, memory_order_relaxed))
+			{
+				return;
+			}
+			continue;
+		}
+
+		if (!contended)
+		{
+			atomic_fetch_add_explicit(&lock->contended, 1, memory_order_relaxed);
+			contended = true;
+		}
+
+		if (spin++ < SYNC_LOCK_SPIN_COUNT) { sm__cpu_relax(); }
+		else if (state & RWLOCK_WRITER_WAITING) { sm__rwlock_park(lock, state); }
+		else
+		{
+			atomic_compare_exchange_weak_explicit(&lock->state, &state, state | RWLOCK_WRITER_WAITING,
+			    memory_order_relaxed, memory_order_relaxed);
+		}
+	}
+}
+
+void
+sync_rwlock_write_exit(struct rwlock *lock)
+{
+	atomic_store(&lock->state, 0);
+	sm__rwlock_wake(lock);
+}
+
+struct lock_stats
+sync_rwlock_stats(struct rwlock *lock)
+{
+	struct lock_stats result;
+
+	result.contended = atomic_load_explicit(&lock->contended, memory_order_relaxed);
+	result.parked = atomic_load_explicit(&lock->parked, memory_order_relaxed);
+
+	return (result);
+}
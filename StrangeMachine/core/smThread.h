@@ -14,8 +14,10 @@
 //
 //      sync_thread       Portable thread
 //      sync_tls          Portable thread-local-storage which you can store a user_data per Tls
-//      sync_mutex        Portable OS mutex, use for long-time data locks, for short-time locks use
-//                      sync_lock_t in atomics.h
+//      sync_mutex        Portable OS mutex (recursive), use for long-time data locks, for short-time locks use
+//                      sync_lock
+//      sync_lock         Non recursive spin-then-park lock, parks on a futex on Linux
+//      sync_rwlock       Reader/writer version of sync_lock
 //      sync_sem          Portable OS semaphore. 'post' increases the count. 'wait' waits on semaphore
 //                      if count is zero,
 //                      else decreases the count and continue
@@ -23,6 +25,7 @@
 //                      where you 'wait' for signal to be triggered, then in another thread you
 //                      'raise' it and 'wait' will continue
 //      sync_queue_spsc   Single producer/Single consumer self contained queue
+//      sync_queue_mpmc   Multi producer/Multi consumer self contained queue
 //
 
 #include "smBase.h"
@@ -43,6 +46,7 @@ b8 thread_running(struct thread *thrd);
 void thread_setname(struct thread *thrd, str8 name);
 void thread_yield(void);
 u32 thread_tid(void);
+u32 thread_hardware_concurrency(void);
 
 #if defined(__GNUC__) || defined(__clang__)
 #	define sync_align_decl(_align, _decl) _decl __attribute__((aligned(_align)))
@@ -66,6 +70,46 @@ b8 sync_mutex_try(struct mutex *mutex);
 #define sync_mutex_unlock(_mtx)	 sync_mutex_exit(_mtx)
 #define sync_mutex_trylock(_mtx) sync_mutex_try(_mtx)
 
+// Lock
+// Non recursive lock for short critical sections. A contended enter spins for a while before parking the thread on a
+// futex (Linux, other platforms keep yielding), taking it again from the thread that holds it deadlocks.
+struct lock
+{
+	atomic_uint state; // 0 free, 1 held, 2 held and somebody may be parked
+
+	atomic_uint contended; // enters that found the lock held
+	atomic_uint parked;    // times a thread went to sleep waiting for it
+};
+
+// Any number of readers or a single writer. A writer waiting for the readers to leave keeps new readers out.
+struct rwlock
+{
+	atomic_uint state; // reader count, plus the writer held and writer waiting bits
+	atomic_uint waiters;
+
+	atomic_uint contended;
+	atomic_uint parked;
+};
+
+struct lock_stats
+{
+	u32 contended;
+	u32 parked;
+};
+
+void sync_lock_init(struct lock *lock);
+void sync_lock_enter(struct lock *lock);
+void sync_lock_exit(struct lock *lock);
+b8 sync_lock_try(struct lock *lock);
+struct lock_stats sync_lock_stats(struct lock *lock);
+
+void sync_rwlock_init(struct rwlock *lock);
+void sync_rwlock_read_enter(struct rwlock *lock);
+void sync_rwlock_read_exit(struct rwlock *lock);
+void sync_rwlock_write_enter(struct rwlock *lock);
+void sync_rwlock_write_exit(struct rwlock *lock);
+struct lock_stats sync_rwlock_stats(struct rwlock *lock);
+
 // Semaphore
 sync_align_decl(16, struct) semaphore
 {
@@ -88,4 +132,26 @@ void sync_signal_release(struct signal *sig);
 void sync_signal_raise(struct signal *sig);
 b8 sync_signal_wait(struct signal *sig, i32 msecs);
 
+// Queues
+// Bounded lock-free ring buffers of fixed size items. The capacity is rounded up to a power of two and never grows:
+// produce returns false (or the number of items that fit for the _n variants) when the queue is full and consume
+// returns false (or the number of items read) when it is empty. Items are copied in and out with memcpy.
+struct queue_spsc;
+struct queue_mpmc;
+
+struct queue_spsc *sync_queue_spsc_create(struct arena *arena, u32 item_size, u32 capacity);
+void sync_queue_spsc_destroy(struct queue_spsc *queue, struct arena *arena);
+b8 sync_queue_spsc_produce(struct queue_spsc *queue, const void *data);
+b8 sync_queue_spsc_consume(struct queue_spsc *queue, void *data);
+u32 sync_queue_spsc_produce_n(struct queue_spsc *queue, const void *data, u32 count);
+u32 sync_queue_spsc_consume_n(struct queue_spsc *queue, void *data, u32 count);
+b8 sync_queue_spsc_full(struct queue_spsc *queue);
+
+struct queue_mpmc *sync_queue_mpmc_create(struct arena *arena, u32 item_size, u32 capacity);
+void sync_queue_mpmc_destroy(struct queue_mpmc *queue, struct arena *arena);
+b8 sync_queue_mpmc_produce(struct queue_mpmc *queue, const void *data);
+b8 sync_queue_mpmc_consume(struct queue_mpmc *queue, void *data);
+u32 sync_queue_mpmc_produce_n(struct queue_mpmc *queue, const void *data, u32 count);
+u32 sync_queue_mpmc_consume_n(struct queue_mpmc *queue, void *data, u32 count);
+
 #endif // SM_THREAD_H
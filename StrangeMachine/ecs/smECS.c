@@ -79,26 +79,112 @@ struct components_info ctable_components[64] = {
      },
 };
 
+// Lays the columns out inside a chunk. As many entities as fit in COMPONENT_POOL_CHUNK_SIZE share a chunk, an
+// archetype bigger than that gets one entity per chunk.
 static void
 component_pool_generate_view(struct component_pool *comp_pool, component_t archetype)
 {
-	u32 size = 0;
-	for (u64 i = 1; (i - 1) < UINT64_MAX; i <<= 1)
+	// the owner column comes first, every component column is followed by the versions of its rows and the chunk
+	// ends with one version per component
+	u32 size = sizeof(handle_t);
+	u32 column_count = 1;
+	u32 component_count = 0;
+	for (component_t bits = archetype; bits; bits &= bits - 1)
 	{
-		component_t component = archetype & i;
-		if (component)
-		{
-			size = (size + 0xFUL) & ~(0xFUL); // Align
+		u32 index = (u32)__builtin_ctzll(bits);
+		size += ctable_components[index].size + sizeof(u32);
+		column_count += 2;
+		component_count++;
+	}
 
-			u32 index = fast_log2_64(component);
-			comp_pool->view[index].size = ctable_components[index].size;
-			comp_pool->view[index].offset = size;
-			comp_pool->view[index].id = ctable_components[index].id;
+	// every column starts 16 bytes aligned, keep room for the padding
+	u32 capacity = 1;
+	u32 fixed = (column_count + 1) * 0xFu + component_count * sizeof(u32);
+	if (size + fixed < COMPONENT_POOL_CHUNK_SIZE) { capacity = (COMPONENT_POOL_CHUNK_SIZE - fixed) / size; }
 
-			size += ctable_components[index].size;
-		}
+	u32 offset = capacity * sizeof(handle_t);
+	for (component_t bits = archetype; bits; bits &= bits - 1)
+	{
+		u32 index = (u32)__builtin_ctzll(bits);
+		offset = (offset + 0xFu) & ~0xFu; // Align
+
+		comp_pool->view[index].size = ctable_components[index].size;
+		comp_pool->view[index].offset = offset;
+		comp_pool->view[index].id = ctable_components[index].id;
+
+		offset += capacity * ctable_components[index].size;
+		offset = (offset + 0xFu) & ~0xFu;
+
+		comp_pool->view[index].version_offset = offset;
+		offset += capacity * sizeof(u32);
 	}
-	comp_pool->size = (size + 0xFUL) & ~(0xFUL);
+
+	offset = (offset + 0xFu) & ~0xFu;
+	comp_pool->chunk_versions_offset = offset;
+	for (component_t bits = archetype; bits; bits &= bits - 1)
+	{
+		u32 index = (u32)__builtin_ctzll(bits);
+		comp_pool->view[index].chunk_version_offset = offset;
+		offset += sizeof(u32);
+	}
+
+	comp_pool->size = size;
+	comp_pool->chunk_capacity = capacity;
+	comp_pool->chunk_size = (offset + 0xFu) & ~0xFu;
+}
+
+sm__force_inline handle_t *
+sm__component_pool_owner(const struct component_pool *comp_pool, u32 row)
+{
+	handle_t *owners = (handle_t *)comp_pool->chunks[row / comp_pool->chunk_capacity];
+
+	return (&owners[row % comp_pool->chunk_capacity]);
+}
+
+sm__force_inline u8 *
+sm__component_pool_slot(const struct component_pool *comp_pool, u32 row, u32 comp_index)
+{
+	const struct component_view *v = &comp_pool->view[comp_index];
+	u8 *chunk = comp_pool->chunks[row / comp_pool->chunk_capacity];
+
+	return (chunk + v->offset + (row % comp_pool->chunk_capacity) * v->size);
+}
+
+sm__force_inline u32 *
+sm__component_pool_row_version(const struct component_pool *comp_pool, u32 row, u32 comp_index)
+{
+	u32 *versions = (u32 *)(comp_pool->chunks[row / comp_pool->chunk_capacity] +
+				comp_pool->view[comp_index].version_offset);
+
+	return (&versions[row % comp_pool->chunk_capacity]);
+}
+
+sm__force_inline u32 *
+sm__component_pool_chunk_version(const struct component_pool *comp_pool, u32 chunk, u32 comp_index)
+{
+	return ((u32 *)(comp_pool->chunks[chunk] + comp_pool->view[comp_index].chunk_version_offset));
+}
+
+// the version of a row moved into another chunk must not be newer than the one of the chunk
+sm__force_inline void
+sm__component_pool_copy_version(
+    struct component_pool *dest_pool, u32 dest_row, const struct component_pool *src_pool, u32 src_row, u32 comp_index)
+{
+	u32 version = *sm__component_pool_row_version(src_pool, src_row, comp_index);
+	u32 dest_chunk = dest_row / dest_pool->chunk_capacity;
+	u32 *chunk_version = sm__component_pool_chunk_version(dest_pool, dest_chunk, comp_index);
+
+	*sm__component_pool_row_version(dest_pool, dest_row, comp_index) = version;
+	*chunk_version = MAX(*chunk_version, version);
+}
+
+static void
+sm__component_pool_chunk_new(struct arena *arena, struct component_pool *comp_pool)
+{
+	u8 *chunk = arena_aligned(arena, 64, comp_pool->chunk_size);
+	memset(chunk + comp_pool->chunk_versions_offset, 0x0, comp_pool->chunk_size - comp_pool->chunk_versions_offset);
+
+	array_push(arena, comp_pool->chunks, chunk);
 }
 
 void
@@ -107,8 +193,7 @@ component_pool_make(struct arena *arena, struct component_pool *comp_pool, u32 c
 	handle_pool_make(arena, &comp_pool->handle_pool, capacity);
 	comp_pool->archetype = archetype;
 	component_pool_generate_view(comp_pool, archetype);
-	comp_pool->cap = capacity;
-	comp_pool->data = arena_aligned(arena, 16, comp_pool->size * capacity);
+	comp_pool->chunks = 0;
 }
 
 void
@@ -117,23 +202,20 @@ component_pool_release(struct arena *arena, struct component_pool *comp_pool)
 	component_pool_unmake_refs(comp_pool);
 
 	handle_pool_release(arena, &comp_pool->handle_pool);
-	arena_free(arena, comp_pool->data);
+	for (u32 i = 0; i < array_len(comp_pool->chunks); ++i) { arena_free(arena, comp_pool->chunks[i]); }
+	array_release(arena, comp_pool->chunks);
 }
 
 static void
-sm__component_pool_unmake_ref(struct component_pool *comp_pool, handle_t handle)
+sm__component_pool_unmake_ref(struct component_pool *comp_pool, u32 row, component_t components)
 {
-	for (u64 i = 1; (i - 1) < UINT64_MAX; i <<= 1)
+	for (component_t bits = comp_pool->archetype & components; bits; bits &= bits - 1)
 	{
-		component_t component = comp_pool->archetype & i;
+		component_t component = bits & (~bits + 1);
 		if (!component_has_ref_counter(component)) { continue; }
 
-		u32 index = handle_index(handle);
-
 		u32 comp_index = fast_log2_64(component);
-		struct component_view *v = &comp_pool->view[comp_index];
-
-		void *data = comp_pool->data + (index * comp_pool->size) + v->offset;
+		void *data = sm__component_pool_slot(comp_pool, row, comp_index);
 		switch (component)
 		{
 		case MESH:
@@ -167,11 +249,7 @@ sm__component_pool_unmake_ref(struct component_pool *comp_pool, handle_t handle)
 void
 component_pool_unmake_refs(struct component_pool *comp_pool)
 {
-	for (u32 i = 0; i < comp_pool->handle_pool.len; ++i)
-	{
-		handle_t handle = handle_at(&comp_pool->handle_pool, i);
-		sm__component_pool_unmake_ref(comp_pool, handle);
-	}
+	for (u32 i = 0; i < comp_pool->handle_pool.len; ++i) { sm__component_pool_unmake_ref(comp_pool, i, ~0ull); }
 }
 
 /**
@@ -194,22 +272,115 @@ component_pool_get_data(struct component_pool *comp_pool, handle_t handle, compo
 	// Check that the handle is valid
 	sm__assert(handle_valid(&comp_pool->handle_pool, handle));
 
-	// Get the index of the handle
-	u32 index = handle_index(handle);
-	sm__assert(index < comp_pool->handle_pool.cap);
+	// The row of the entity is the dense index of its handle
+	u32 row = comp_pool->handle_pool.sparse[handle_index(handle)];
 
 	u32 comp_index = fast_log2_64(component);
 	sm__assert(comp_index < 64);
+	sm__assert(component == comp_pool->view[comp_index].id);
 
-	struct component_view *v = &comp_pool->view[comp_index];
-	sm__assert(component == v->id);
+	result = sm__component_pool_slot(comp_pool, row, comp_index);
 
-	// If the view has the specified component, return a pointer to its data
-	result = (u8 *)comp_pool->data + (index * comp_pool->size) + v->offset;
+	return (result);
+}
+
+void *
+component_pool_get_row_data(const struct component_pool *comp_pool, u32 row, component_t component)
+{
+	void *result;
+
+	sm__assert(row < comp_pool->handle_pool.len);
+
+	u32 comp_index = fast_log2_64(component);
+	sm__assert(comp_index < 64);
+	sm__assert(component == comp_pool->view[comp_index].id);
+
+	result = sm__component_pool_slot(comp_pool, row, comp_index);
 
 	return (result);
 }
 
+void *
+component_pool_get_column(const struct component_pool *comp_pool, u32 chunk, component_t component)
+{
+	void *result;
+
+	sm__assert(chunk < array_len(comp_pool->chunks));
+
+	u32 comp_index = fast_log2_64(component);
+	sm__assert(comp_index < 64);
+	sm__assert(component == comp_pool->view[comp_index].id);
+
+	result = comp_pool->chunks[chunk] + comp_pool->view[comp_index].offset;
+
+	return (result);
+}
+
+handle_t
+component_pool_get_owner(const struct component_pool *comp_pool, u32 row)
+{
+	sm__assert(row < comp_pool->handle_pool.len);
+
+	return (*sm__component_pool_owner(comp_pool, row));
+}
+
+const handle_t *
+component_pool_get_owner_column(const struct component_pool *comp_pool, u32 chunk)
+{
+	sm__assert(chunk < array_len(comp_pool->chunks));
+
+	return ((const handle_t *)comp_pool->chunks[chunk]);
+}
+
+void
+component_pool_mark_changed(const struct component_pool *comp_pool, u32 row, component_t components, u32 tick)
+{
+	sm__assert(row < comp_pool->handle_pool.len);
+
+	u32 chunk = row / comp_pool->chunk_capacity;
+	for (component_t bits = comp_pool->archetype & components; bits; bits &= bits - 1)
+	{
+		u32 comp_index = (u32)__builtin_ctzll(bits);
+		*sm__component_pool_row_version(comp_pool, row, comp_index) = tick;
+		*sm__component_pool_chunk_version(comp_pool, chunk, comp_index) = tick;
+	}
+}
+
+void
+component_pool_mark_rows_changed(
+    const struct component_pool *comp_pool, u32 begin, u32 end, component_t components, u32 tick)
+{
+	sm__assert(begin < end && end <= comp_pool->handle_pool.len);
+	sm__assert(begin / comp_pool->chunk_capacity == (end - 1) / comp_pool->chunk_capacity);
+
+	u32 chunk = begin / comp_pool->chunk_capacity;
+	for (component_t bits = comp_pool->archetype & components; bits; bits &= bits - 1)
+	{
+		u32 comp_index = (u32)__builtin_ctzll(bits);
+		u32 *versions = sm__component_pool_row_version(comp_pool, begin, comp_index);
+		for (u32 i = 0; i < end - begin; ++i) { versions[i] = tick; }
+		*sm__component_pool_chunk_version(comp_pool, chunk, comp_index) = tick;
+	}
+}
+
+u32
+component_pool_get_row_version(const struct component_pool *comp_pool, u32 row, component_t component)
+{
+	sm__assert(row < comp_pool->handle_pool.len);
+	sm__assert(comp_pool->archetype & component);
+
+	return (*sm__component_pool_row_version(comp_pool, row, fast_log2_64(component)));
+}
+
+u32
+component_pool_get_chunk_version(const struct component_pool *comp_pool, u32 chunk, component_t component)
+{
+	sm__assert(chunk < array_len(comp_pool->chunks));
+	sm__assert(comp_pool->archetype & component);
+
+	return (*sm__component_pool_chunk_version(comp_pool, chunk, fast_log2_64(component)));
+}
+
 b8
 component_pool_handle_is_valid(struct component_pool *comp_pool, handle_t handle)
 {
@@ -220,27 +391,131 @@ component_pool_handle_is_valid(struct component_pool *comp_pool, handle_t handle
 	return (result);
 }
 
+// Components are moved with memcpy, the ones pointing into themselves are patched afterwards
+static void
+sm__component_relocated(u32 comp_index, void *dest, void *src)
+{
+	switch (ctable_components[comp_index].id)
+	{
+	case PARTICLE_EMITTER:
+		{
+			particle_emitter_component *pe_dest = dest, *pe_src = src;
+
+			struct particle *sentinels[2][2] = {
+			    {&pe_dest->free_sentinel, &pe_src->free_sentinel},
+			    {&pe_dest->active_sentinel, &pe_src->active_sentinel},
+			};
+			for (u32 i = 0; i < 2; ++i)
+			{
+				struct particle *sentinel = sentinels[i][0];
+				if (sentinel->next == 0) { continue; } // never initialized
+				if (sentinel->next == sentinels[i][1]) { dll_init_sentinel(sentinel); }
+				else
+				{
+					sentinel->next->prev = sentinel;
+					sentinel->prev->next = sentinel;
+				}
+			}
+		}
+		break;
+	default: break;
+	}
+}
+
 handle_t
-component_pool_handle_new(struct arena *arena, struct component_pool *comp_pool)
+component_pool_handle_new(struct arena *arena, struct component_pool *comp_pool, handle_t owner)
 {
 	handle_t result = INVALID_HANDLE;
 
 	result = handle_new(arena, &comp_pool->handle_pool);
 	sm__assert(result != INVALID_HANDLE);
 
-	if (comp_pool->cap != comp_pool->handle_pool.cap)
+	// chunks are never moved, running out only adds one
+	u32 row = comp_pool->handle_pool.len - 1;
+	if (row == array_len(comp_pool->chunks) * comp_pool->chunk_capacity)
+	{
+		sm__component_pool_chunk_new(arena, comp_pool);
+	}
+
+	*sm__component_pool_owner(comp_pool, row) = owner;
+	for (component_t bits = comp_pool->archetype; bits; bits &= bits - 1)
 	{
-		// comp_pool->data = arena_resize(arena, comp_pool->data, comp_pool->handle_pool.cap * comp_pool->size);
-		void *new_data = arena_aligned(arena, 16, comp_pool->handle_pool.cap * comp_pool->size);
-		memcpy(new_data, comp_pool->data, comp_pool->cap * comp_pool->size);
-		arena_free(arena, comp_pool->data);
-		comp_pool->data = new_data;
-		comp_pool->cap = comp_pool->handle_pool.cap;
+		u32 comp_index = (u32)__builtin_ctzll(bits);
+		memset(sm__component_pool_slot(comp_pool, row, comp_index), 0x0, comp_pool->view[comp_index].size);
+		*sm__component_pool_row_version(comp_pool, row, comp_index) = 0;
 	}
 
 	return (result);
 }
 
+void
+component_pool_reserve(struct arena *arena, struct component_pool *comp_pool, u32 count)
+{
+	handle_pool_reserve(arena, &comp_pool->handle_pool, count);
+
+	u32 rows = comp_pool->handle_pool.len + count;
+	u32 chunk_count = (rows + comp_pool->chunk_capacity - 1) / comp_pool->chunk_capacity;
+	if (chunk_count <= array_len(comp_pool->chunks)) { return; }
+
+	array_reserve(arena, comp_pool->chunks, chunk_count);
+	while (array_len(comp_pool->chunks) < chunk_count) { sm__component_pool_chunk_new(arena, comp_pool); }
+}
+
+u32
+component_pool_handle_new_batch(
+    struct arena *arena, struct component_pool *comp_pool, u32 count, const handle_t *owners)
+{
+	component_pool_reserve(arena, comp_pool, count);
+
+	u32 first = comp_pool->handle_pool.len;
+	for (u32 i = 0; i < count; ++i)
+	{
+		handle_new(arena, &comp_pool->handle_pool);
+		*sm__component_pool_owner(comp_pool, first + i) = owners[i];
+	}
+
+	// zero one column at a time, as many rows as fit in the chunk at once
+	u32 end = first + count;
+	for (u32 row = first; row < end;)
+	{
+		u32 rows = MIN(comp_pool->chunk_capacity - row % comp_pool->chunk_capacity, end - row);
+		for (component_t bits = comp_pool->archetype; bits; bits &= bits - 1)
+		{
+			u32 comp_index = (u32)__builtin_ctzll(bits);
+			u8 *column = sm__component_pool_slot(comp_pool, row, comp_index);
+			memset(column, 0x0, rows * comp_pool->view[comp_index].size);
+			memset(sm__component_pool_row_version(comp_pool, row, comp_index), 0x0, rows * sizeof(u32));
+		}
+		row += rows;
+	}
+
+	return (first);
+}
+
+// moves the last row into the row of handle, mirroring what handle_remove does with the dense array
+static void
+sm__component_pool_swap_remove(struct component_pool *comp_pool, handle_t handle)
+{
+	u32 row = comp_pool->handle_pool.sparse[handle_index(handle)];
+	u32 last = comp_pool->handle_pool.len - 1;
+
+	if (row != last)
+	{
+		*sm__component_pool_owner(comp_pool, row) = *sm__component_pool_owner(comp_pool, last);
+		for (component_t bits = comp_pool->archetype; bits; bits &= bits - 1)
+		{
+			u32 comp_index = (u32)__builtin_ctzll(bits);
+			u8 *dest = sm__component_pool_slot(comp_pool, row, comp_index);
+			u8 *src = sm__component_pool_slot(comp_pool, last, comp_index);
+			memcpy(dest, src, comp_pool->view[comp_index].size);
+			sm__component_relocated(comp_index, dest, src);
+			sm__component_pool_copy_version(comp_pool, row, comp_pool, last, comp_index);
+		}
+	}
+
+	handle_remove(&comp_pool->handle_pool, handle);
+}
+
 void
 component_pool_handle_remove(struct component_pool *comp_pool, handle_t handle)
 {
@@ -249,13 +524,38 @@ component_pool_handle_remove(struct component_pool *comp_pool, handle_t handle)
 	// Check that the handle is valid
 	sm__assert(handle_valid(&comp_pool->handle_pool, handle));
 
-	sm__component_pool_unmake_ref(comp_pool, handle);
+	sm__component_pool_unmake_ref(comp_pool, comp_pool->handle_pool.sparse[handle_index(handle)], ~0ull);
+	sm__component_pool_swap_remove(comp_pool, handle);
+}
 
-	handle_remove(&comp_pool->handle_pool, handle);
+void
+component_pool_handle_migrate(
+    struct component_pool *src_pool, handle_t src, struct component_pool *dest_pool, handle_t dest)
+{
+	sm__assert(src_pool != dest_pool);
+	sm__assert(handle_valid(&src_pool->handle_pool, src));
+	sm__assert(handle_valid(&dest_pool->handle_pool, dest));
 
-	u32 index = handle_index(handle);
+	u32 src_row = src_pool->handle_pool.sparse[handle_index(src)];
+	u32 dest_row = dest_pool->handle_pool.sparse[handle_index(dest)];
+
+	*sm__component_pool_owner(dest_pool, dest_row) = *sm__component_pool_owner(src_pool, src_row);
+
+	for (component_t bits = src_pool->archetype & dest_pool->archetype; bits; bits &= bits - 1)
+	{
+		u32 comp_index = (u32)__builtin_ctzll(bits);
+		sm__assert(src_pool->view[comp_index].id == dest_pool->view[comp_index].id);
+
+		u8 *dest_data = sm__component_pool_slot(dest_pool, dest_row, comp_index);
+		u8 *src_data = sm__component_pool_slot(src_pool, src_row, comp_index);
+		memcpy(dest_data, src_data, dest_pool->view[comp_index].size);
+		sm__component_relocated(comp_index, dest_data, src_data);
+		sm__component_pool_copy_version(dest_pool, dest_row, src_pool, src_row, comp_index);
+	}
 
-	memset((u8 *)comp_pool->data + (index * comp_pool->size), 0x0, comp_pool->size);
+	// what dest has no column for is dropped with the src row
+	sm__component_pool_unmake_ref(src_pool, src_row, ~dest_pool->archetype);
+	sm__component_pool_swap_remove(src_pool, src);
 }
 
 b8
@@ -371,14 +671,12 @@ system_iter_get_component(struct system_iter *iter, component_t component)
 	u32 comp_index = fast_log2_64(component);
 	sm__assert(comp_index < 64);
 
-	struct component_view *v = &iter->comp_pool_ref->view[comp_index];
-	sm__assert(component == v->id);
+	sm__assert(component == iter->comp_pool_ref->view[comp_index].id);
 
 	sm__assert(iter->index > 0);
-	u32 index = iter->index - 1;
+	u32 row = iter->index - 1;
 
-	// If the view has the specified component, return a pointer to its data
-	result = (u8 *)iter->comp_pool_ref->data + (index * iter->comp_pool_ref->size) + v->offset;
+	result = sm__component_pool_slot(iter->comp_pool_ref, row, comp_index);
 
 	return (result);
 }
@@ -15,12 +15,26 @@ typedef u64 component_t;
 
 struct component_pool;
 
+// Archetype storage
+// The entities of a pool live in fixed size chunks. A chunk holds chunk_capacity entities as one column per
+// component, so a system touching a single component sweeps a contiguous array instead of striding over the others.
+// Entities occupy the rows [0, handle_pool.len) in dense order: the row of an entity is the dense index of its handle,
+// and removing one moves the last row into the hole. The first column of every chunk holds the owner of each row, the
+// handle the scene gave the entity, so going from a row back to its entity is a single load.
+//
+// Every component of every row also carries a version, the tick of its last write, and every column of a chunk the
+// newest version of its rows. A pool does not know about ticks: whoever hands out data to be written stamps it with
+// component_pool_mark_changed and readers compare versions against the tick they last looked at.
+#define COMPONENT_POOL_CHUNK_SIZE KB(16)
+
 struct component_view
 {
 	component_t id;
 
 	u32 size;
-	u32 offset;
+	u32 offset;		  // of the column inside each chunk
+	u32 version_offset;	  // of the column of row versions
+	u32 chunk_version_offset; // of the version of the whole column
 };
 
 struct component_pool
@@ -30,9 +44,11 @@ struct component_pool
 	struct handle_pool handle_pool;
 	struct component_view view[64];
 
-	u32 size; // size of each element
-	u32 cap;
-	u8 *data;
+	u32 size;	    // bytes of one entity across all columns, owner included
+	u32 chunk_capacity; // entities per chunk
+	u32 chunk_size;	    // bytes per chunk
+	u32 chunk_versions_offset;
+	array(u8 *) chunks;
 };
 
 void component_pool_make(struct arena *arena, struct component_pool *comp_pool, u32 capacity, component_t archetype);
@@ -42,11 +58,34 @@ void component_pool_release(struct arena *arena, struct component_pool *comp_poo
 // Useful when you want to clear the arena but don't want to waste CPU cycles freeing each component individually
 void component_pool_unmake_refs(struct component_pool *comp_pool);
 
-handle_t component_pool_handle_new(struct arena *arena, struct component_pool *comp_pool);
+// new rows are zeroed, owner is stored in the owner column of the row
+handle_t component_pool_handle_new(struct arena *arena, struct component_pool *comp_pool, handle_t owner);
+// makes room for count more rows, handle slots and chunks are allocated up front
+void component_pool_reserve(struct arena *arena, struct component_pool *comp_pool, u32 count);
+// creates count zeroed rows at once, owners[i] goes to the i-th one. Returns the first row: the rows are contiguous
+// and the handle of row first + i is handle_at(&comp_pool->handle_pool, first + i)
+u32 component_pool_handle_new_batch(
+    struct arena *arena, struct component_pool *comp_pool, u32 count, const handle_t *owners);
 void component_pool_handle_remove(struct component_pool *comp_pool, handle_t handl);
+// Copies the components both archetypes share from the src row to the dest row and removes the src row. The
+// references of the shared components now belong to dest, the ones of components dest lacks are released
+void component_pool_handle_migrate(
+    struct component_pool *src_pool, handle_t src, struct component_pool *dest_pool, handle_t dest);
 void *component_pool_get_data(struct component_pool *comp_pool, handle_t handle, component_t component);
+void *component_pool_get_row_data(const struct component_pool *comp_pool, u32 row, component_t component);
+handle_t component_pool_get_owner(const struct component_pool *comp_pool, u32 row);
+const handle_t *component_pool_get_owner_column(const struct component_pool *comp_pool, u32 chunk);
+// first element of the column of component in a chunk, the column holds chunk_capacity elements
+void *component_pool_get_column(const struct component_pool *comp_pool, u32 chunk, component_t component);
 b8 component_pool_handle_is_valid(struct component_pool *comp_pool, handle_t handle);
 
+void component_pool_mark_changed(const struct component_pool *comp_pool, u32 row, component_t components, u32 tick);
+// [begin, end) must lie inside one chunk
+void component_pool_mark_rows_changed(
+    const struct component_pool *comp_pool, u32 begin, u32 end, component_t components, u32 tick);
+u32 component_pool_get_row_version(const struct component_pool *comp_pool, u32 row, component_t component);
+u32 component_pool_get_chunk_version(const struct component_pool *comp_pool, u32 chunk, component_t component);
+
 b8 component_has_ref_counter(component_t component);
 
 void ecs_manager_print_archeype(struct arena *arena, component_t archetype);
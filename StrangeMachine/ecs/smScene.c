@@ -13,6 +13,15 @@ scene_make(struct arena *arena, struct scene *scene)
 	scene->nodes_cap = scene->nodes_handle_pool.cap;
 	scene->arena = arena;
 	scene->component_handle_pool = 0;
+	scene->archetype_edges = 0;
+	scene->archetype_map = 0;
+	scene->archetype_map_cap = 0;
+	scene->queries = 0;
+	scene->tick = 1;
+	scene->hierarchy = 0;
+	scene->hierarchy_transforms = 0;
+	scene->hierarchy_stale = false;
+	memset(scene->commands, 0x0, sizeof(scene->commands));
 	scene->sys_info = 0;
 }
 
@@ -20,11 +29,17 @@ void
 scene_release(struct arena *arena, struct scene *scene)
 {
 	array_release(arena, scene->sys_info);
+	array_release(arena, scene->hierarchy);
+	array_release(arena, scene->hierarchy_transforms);
 	for (u32 i = 0; i < array_len(scene->component_handle_pool); ++i)
 	{
 		component_pool_release(arena, &scene->component_handle_pool[i]);
 	}
 	array_release(arena, scene->component_handle_pool);
+	for (u32 i = 0; i < array_len(scene->queries); ++i) { array_release(arena, scene->queries[i].comp_pools); }
+	array_release(arena, scene->queries);
+	array_release(arena, scene->archetype_edges);
+	if (scene->archetype_map) { arena_free(arena, scene->archetype_map); }
 
 	handle_pool_release(arena, &scene->nodes_handle_pool);
 	// array_release(arena, scene->indirect_access);
@@ -56,6 +71,166 @@ sm__scene_indirect_access_new_handle(struct arena *arena, struct scene *scene)
 	return (result);
 }
 
+sm__force_inline u32
+sm__scene_archetype_hash(component_t archetype, u32 cap)
+{
+	// Fibonacci hashing, the high bits of the product are the well mixed ones
+	u32 result = (u32)((archetype * 0x9E3779B97F4A7C15ull) >> 32) & (cap - 1);
+
+	return (result);
+}
+
+static u32
+sm__scene_archetype_find(const struct scene *scene, component_t archetype)
+{
+	if (scene->archetype_map_cap == 0) { return (SCENE_ARCHETYPE_NONE); }
+
+	u32 mask = scene->archetype_map_cap - 1;
+	for (u32 i = sm__scene_archetype_hash(archetype, scene->archetype_map_cap);; i = (i + 1) & mask)
+	{
+		const struct archetype_slot *slot = &scene->archetype_map[i];
+		if (slot->comp_pool_index == SCENE_ARCHETYPE_NONE || slot->archetype == archetype)
+		{
+			return (slot->comp_pool_index);
+		}
+	}
+}
+
+static void
+sm__scene_archetype_place(struct archetype_slot *map, u32 cap, component_t archetype, u32 comp_pool_index)
+{
+	u32 mask = cap - 1;
+	u32 i = sm__scene_archetype_hash(archetype, cap);
+	while (map[i].comp_pool_index != SCENE_ARCHETYPE_NONE) { i = (i + 1) & mask; }
+
+	map[i] = (struct archetype_slot){.archetype = archetype, .comp_pool_index = comp_pool_index};
+}
+
+static void
+sm__scene_archetype_insert(struct arena *arena, struct scene *scene, component_t archetype, u32 comp_pool_index)
+{
+	// pools are never destroyed, the table only grows. Keep it at most half full
+	if (array_len(scene->component_handle_pool) * 2 > scene->archetype_map_cap)
+	{
+		u32 cap = MAX(scene->archetype_map_cap * 2, 16u);
+		struct archetype_slot *map = arena_reserve(arena, cap * sizeof(struct archetype_slot));
+		for (u32 i = 0; i < cap; ++i)
+		{
+			map[i] = (struct archetype_slot){.comp_pool_index = SCENE_ARCHETYPE_NONE};
+		}
+
+		for (u32 i = 0; i < scene->archetype_map_cap; ++i)
+		{
+			struct archetype_slot *slot = &scene->archetype_map[i];
+			if (slot->comp_pool_index != SCENE_ARCHETYPE_NONE)
+			{
+				sm__scene_archetype_place(map, cap, slot->archetype, slot->comp_pool_index);
+			}
+		}
+
+		if (scene->archetype_map) { arena_free(arena, scene->archetype_map); }
+		scene->archetype_map = map;
+		scene->archetype_map_cap = cap;
+	}
+
+	sm__scene_archetype_place(scene->archetype_map, scene->archetype_map_cap, archetype, comp_pool_index);
+}
+
+sm__force_inline b32
+sm__scene_query_matches(const struct scene_query *query, component_t archetype)
+{
+	b32 result = (archetype & query->with) == query->with && (archetype & query->without) == 0;
+
+	return (result);
+}
+
+// index of the pool of archetype, the pool is created the first time the archetype shows up
+static u32
+sm__scene_archetype_get(struct arena *arena, struct scene *scene, component_t archetype)
+{
+	u32 result = sm__scene_archetype_find(scene, archetype);
+	if (result != SCENE_ARCHETYPE_NONE) { return (result); }
+
+	array_push(arena, scene->component_handle_pool, (struct component_pool){0});
+	result = array_len(scene->component_handle_pool) - 1;
+	component_pool_make(arena, &scene->component_handle_pool[result], 8, archetype);
+
+	struct archetype_edges edges;
+	memset(&edges, 0xFF, sizeof(edges));
+	array_push(arena, scene->archetype_edges, edges);
+
+	sm__scene_archetype_insert(arena, scene, archetype, result);
+
+	for (u32 i = 0; i < array_len(scene->queries); ++i)
+	{
+		struct scene_query *query = &scene->queries[i];
+		if (sm__scene_query_matches(query, archetype)) { array_push(arena, query->comp_pools, result); }
+	}
+
+	return (result);
+}
+
+// index of the pool reached from the pool comp_pool_index by adding (or removing) components
+static u32
+sm__scene_archetype_transition(
+    struct arena *arena, struct scene *scene, u32 comp_pool_index, component_t components, b32 add)
+{
+	u32 result;
+
+	sm__assert(components != 0);
+
+	component_t archetype = scene->component_handle_pool[comp_pool_index].archetype;
+	component_t new_archetype = add ? archetype | components : archetype & ~components;
+
+	// only single component transitions are cached, a mask of several goes straight to the table
+	if (components & (components - 1)) { return (sm__scene_archetype_get(arena, scene, new_archetype)); }
+
+	u32 comp_index = fast_log2_64(components);
+	struct archetype_edges *edges = &scene->archetype_edges[comp_pool_index];
+
+	result = add ? edges->add[comp_index] : edges->remove[comp_index];
+	if (result != SCENE_ARCHETYPE_NONE) { return (result); }
+
+	result = sm__scene_archetype_get(arena, scene, new_archetype);
+
+	// the edge goes both ways. edges may have moved when the pool was created
+	if (add)
+	{
+		scene->archetype_edges[comp_pool_index].add[comp_index] = result;
+		scene->archetype_edges[result].remove[comp_index] = comp_pool_index;
+	}
+	else
+	{
+		scene->archetype_edges[comp_pool_index].remove[comp_index] = result;
+		scene->archetype_edges[result].add[comp_index] = comp_pool_index;
+	}
+
+	return (result);
+}
+
+// moves the components of entity to the pool comp_pool_index
+static void
+sm__scene_entity_move(struct arena *arena, struct scene *scene, entity_t entity, u32 comp_pool_index)
+{
+	struct node *node = &scene->nodes[handle_index(entity.handle)];
+
+	struct component_pool *new_comp_pool = &scene->component_handle_pool[comp_pool_index];
+	handle_t new_handle = component_pool_handle_new(arena, new_comp_pool, entity.handle);
+
+	// the moved row of the old pool keeps its handle, only this entity changes pool
+	component_pool_handle_migrate(
+	    &scene->component_handle_pool[node->component_pool_index], node->handle, new_comp_pool, new_handle);
+
+	if ((node->archetype ^ new_comp_pool->archetype) & TRANSFORM) { scene->hierarchy_stale = true; }
+
+	node->handle = new_handle;
+	node->component_pool_index = comp_pool_index;
+	node->archetype = new_comp_pool->archetype;
+
+	u32 row = new_comp_pool->handle_pool.sparse[handle_index(new_handle)];
+	component_pool_mark_changed(new_comp_pool, row, new_comp_pool->archetype, scene->tick);
+}
+
 void
 scene_unmake_refs(struct scene *scene)
 {
@@ -87,8 +262,16 @@ scene_load(struct arena *arena, struct scene *scene, str8 name)
 	struct sm__resource_scene *scn_resource = resource_scene_at(scene_handle);
 
 	u32 node_count = array_len(scn_resource->nodes);
+
+	// scratch for the duration of the load, given back as soon as the hierarchy is built. The frame arena is small,
+	// scenes that do not fit in what is left of it (with the 16 bytes frame_alloc may align by) use the scene arena
+	u32 scratch_size = node_count * (u32)sizeof(struct child_parent_hierarchy);
+	struct linear_arena *frame = frame_arena_get();
+	b32 scratch_on_frame = frame->size - frame->offset >= scratch_size + 16;
+
+	struct arena_temp temp = arena_temp_begin(frame);
 	struct child_parent_hierarchy *nodes_hierarchy;
-	nodes_hierarchy = arena_reserve(arena, node_count * sizeof(struct child_parent_hierarchy));
+	nodes_hierarchy = scratch_on_frame ? frame_alloc(scratch_size) : arena_reserve(arena, scratch_size);
 
 	for (u32 i = 0; i < array_len(scn_resource->nodes); ++i)
 	{
@@ -394,7 +577,8 @@ scene_load(struct arena *arena, struct scene *scene, str8 name)
 		self_node->flags &= ~(u32)HIERARCHY_FLAG_DIRTY;
 	}
 
-	arena_free(arena, nodes_hierarchy);
+	if (scratch_on_frame) { arena_temp_end(temp); }
+	else { arena_free(arena, nodes_hierarchy); }
 
 	return;
 }
@@ -404,52 +588,124 @@ scene_entity_new(struct arena *arena, struct scene *scene, component_t archetype
 {
 	entity_t result;
 
-	for (u32 i = 0; i < array_len(scene->component_handle_pool); ++i)
-	{
-		if (scene->component_handle_pool[i].archetype == archetype)
-		{
-			handle_t component_handle = component_pool_handle_new(arena, &scene->component_handle_pool[i]);
-			// result.handle = handle_new(arena, &scene->indirect_handle_pool);
-			result.handle = sm__scene_indirect_access_new_handle(arena, scene);
-
-			u32 index = handle_index(result.handle);
-			scene->nodes[index].handle = component_handle;
-			scene->nodes[index].component_pool_index = i;
-			scene->nodes[index].archetype = archetype;
-
-			scene->nodes[index].self = result;
-			scene->nodes[index].parent.handle = INVALID_HANDLE;
-			scene->nodes[index].children = 0;
-			scene->nodes[index].flags = 0;
+	u32 comp_pool_index = sm__scene_archetype_get(arena, scene, archetype);
 
-			return (result);
-		}
-	}
-
-	array_push(arena, scene->component_handle_pool, (struct component_pool){0});
-	struct component_pool *comp_pool = array_last_item(scene->component_handle_pool);
-
-	u32 component_index = array_len(scene->component_handle_pool) - 1;
-	component_pool_make(arena, comp_pool, 8, archetype);
-
-	handle_t component_handle = component_pool_handle_new(arena, comp_pool);
+	struct component_pool *comp_pool = &scene->component_handle_pool[comp_pool_index];
 
 	// result.handle = handle_new(arena, &scene->indirect_handle_pool);
 	result.handle = sm__scene_indirect_access_new_handle(arena, scene);
-	u32 index = handle_index(result.handle);
+	handle_t component_handle = component_pool_handle_new(arena, comp_pool, result.handle);
+	component_pool_mark_changed(comp_pool, comp_pool->handle_pool.len - 1, archetype, scene->tick);
 
+	u32 index = handle_index(result.handle);
 	scene->nodes[index].handle = component_handle;
-	scene->nodes[index].component_pool_index = component_index;
+	scene->nodes[index].component_pool_index = comp_pool_index;
 	scene->nodes[index].archetype = archetype;
 
 	scene->nodes[index].self = result;
 	scene->nodes[index].parent.handle = INVALID_HANDLE;
-	scene->nodes[index].children = 0;
+	scene->nodes[index].first_child.handle = INVALID_HANDLE;
+	scene->nodes[index].next_sibling.handle = INVALID_HANDLE;
+	scene->nodes[index].prev_sibling.handle = INVALID_HANDLE;
 	scene->nodes[index].flags = 0;
 
+	if (archetype & TRANSFORM) { scene->hierarchy_stale = true; }
+
 	return (result);
 }
 
+static void
+sm__scene_nodes_reserve(struct arena *arena, struct scene *scene, u32 count)
+{
+	handle_pool_reserve(arena, &scene->nodes_handle_pool, count);
+	if (scene->nodes_cap != scene->nodes_handle_pool.cap)
+	{
+		scene->nodes = arena_resize(arena, scene->nodes, sizeof(struct node) * scene->nodes_handle_pool.cap);
+		scene->nodes_cap = scene->nodes_handle_pool.cap;
+	}
+}
+
+void
+scene_entity_new_batch(
+    struct arena *arena, struct scene *scene, component_t archetype, u32 count, entity_t *out_entities)
+{
+	if (count == 0) { return; }
+
+	u32 comp_pool_index = sm__scene_archetype_get(arena, scene, archetype);
+	struct component_pool *comp_pool = &scene->component_handle_pool[comp_pool_index];
+
+	sm__scene_nodes_reserve(arena, scene, count);
+	for (u32 i = 0; i < count; ++i) { out_entities[i].handle = handle_new(arena, &scene->nodes_handle_pool); }
+
+	u32 first = component_pool_handle_new_batch(arena, comp_pool, count, (const handle_t *)out_entities);
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		struct node *node = &scene->nodes[handle_index(out_entities[i].handle)];
+
+		node->handle = handle_at(&comp_pool->handle_pool, first + i);
+		component_pool_mark_changed(comp_pool, first + i, archetype, scene->tick);
+		node->component_pool_index = comp_pool_index;
+		node->archetype = archetype;
+
+		node->self = out_entities[i];
+		node->parent.handle = INVALID_HANDLE;
+		node->first_child.handle = INVALID_HANDLE;
+		node->next_sibling.handle = INVALID_HANDLE;
+		node->prev_sibling.handle = INVALID_HANDLE;
+		node->flags = 0;
+	}
+
+	if (archetype & TRANSFORM) { scene->hierarchy_stale = true; }
+}
+
+void
+scene_reserve(struct arena *arena, struct scene *scene, component_t archetype, u32 count)
+{
+	u32 comp_pool_index = sm__scene_archetype_get(arena, scene, archetype);
+
+	sm__scene_nodes_reserve(arena, scene, count);
+	component_pool_reserve(arena, &scene->component_handle_pool[comp_pool_index], count);
+}
+
+static void
+sm__scene_node_detach(struct scene *scene, struct node *node)
+{
+	if (node->parent.handle == INVALID_HANDLE) { return; }
+
+	if (node->prev_sibling.handle != INVALID_HANDLE)
+	{
+		scene->nodes[handle_index(node->prev_sibling.handle)].next_sibling = node->next_sibling;
+	}
+	else { scene->nodes[handle_index(node->parent.handle)].first_child = node->next_sibling; }
+
+	if (node->next_sibling.handle != INVALID_HANDLE)
+	{
+		scene->nodes[handle_index(node->next_sibling.handle)].prev_sibling = node->prev_sibling;
+	}
+
+	node->parent.handle = INVALID_HANDLE;
+	node->next_sibling.handle = INVALID_HANDLE;
+	node->prev_sibling.handle = INVALID_HANDLE;
+}
+
+// node must be detached, it becomes the first child of parent
+static void
+sm__scene_node_attach(struct scene *scene, struct node *node, struct node *parent)
+{
+	sm__assert(node->parent.handle == INVALID_HANDLE);
+
+	if (parent->first_child.handle != INVALID_HANDLE)
+	{
+		scene->nodes[handle_index(parent->first_child.handle)].prev_sibling = node->self;
+	}
+
+	node->parent = parent->self;
+	node->next_sibling = parent->first_child;
+	node->prev_sibling.handle = INVALID_HANDLE;
+	parent->first_child = node->self;
+}
+
 void
 scene_entity_remove(struct scene *scene, entity_t entity)
 {
@@ -465,6 +721,18 @@ scene_entity_remove(struct scene *scene, entity_t entity)
 
 	component_pool_handle_remove(comp_pool, ett);
 
+	// leave no link to the freed slot behind: self leaves its parent and the children become roots
+	struct node *node = &scene->nodes[index];
+	sm__scene_node_detach(scene, node);
+	while (node->first_child.handle != INVALID_HANDLE)
+	{
+		struct node *child = &scene->nodes[handle_index(node->first_child.handle)];
+		sm__scene_node_detach(scene, child);
+		child->flags |= HIERARCHY_FLAG_DIRTY;
+	}
+
+	if (node->archetype & TRANSFORM) { scene->hierarchy_stale = true; }
+
 	handle_remove(&scene->nodes_handle_pool, entity.handle);
 }
 
@@ -514,86 +782,39 @@ scene_entity_add_component(struct arena *arena, struct scene *scene, entity_t en
 {
 	sm__assert(handle_valid(&scene->nodes_handle_pool, entity.handle));
 
-	const u32 indirect_index = handle_index(entity.handle);
-	const component_t old_archetype = scene->nodes[indirect_index].archetype;
-
-	const handle_t old_handle = scene->nodes[indirect_index].handle;
-	const u32 old_component_pool_index = scene->nodes[indirect_index].component_pool_index;
-
-	if (old_archetype & components)
+	struct node *node = &scene->nodes[handle_index(entity.handle)];
+	if (node->archetype & components)
 	{
-		log_warn(str8_from("entity {u3d} already has {u6d} component"), entity.handle, components);
+		log_warn(str8_from("entity {u6d} already has {u6d} component"), (u64)entity.handle, components);
 		return;
 	}
 
-	component_t new_archetype = old_archetype | components;
-	handle_t new_handle = INVALID_HANDLE;
-	for (u32 i = 0; i < array_len(scene->component_handle_pool); ++i)
-	{
-		if (scene->component_handle_pool[i].archetype == new_archetype)
-		{
-			new_handle = component_pool_handle_new(arena, &scene->component_handle_pool[i]);
-
-			scene->nodes[indirect_index].handle = new_handle;
-			scene->nodes[indirect_index].component_pool_index = i;
-			scene->nodes[indirect_index].archetype = new_archetype;
-
-			break;
-		}
-	}
-
-	if (new_handle == INVALID_HANDLE)
-	{
-		struct component_pool comp_pool = {0};
-		array_push(arena, scene->component_handle_pool, comp_pool);
-
-		u32 component_index = array_len(scene->component_handle_pool) - 1;
-		component_pool_make(arena, &scene->component_handle_pool[component_index], 8, new_archetype);
-
-		new_handle = component_pool_handle_new(arena, &scene->component_handle_pool[component_index]);
-
-		scene->nodes[indirect_index].handle = new_handle;
-		scene->nodes[indirect_index].component_pool_index = component_index;
-		scene->nodes[indirect_index].archetype = new_archetype;
-	}
-	sm__assert(new_handle != INVALID_HANDLE);
+	u32 comp_pool_index =
+	    sm__scene_archetype_transition(arena, scene, node->component_pool_index, components, true);
+	sm__scene_entity_move(arena, scene, entity, comp_pool_index);
+}
 
-	u32 new_index = handle_index(new_handle);
-	u32 old_index = handle_index(old_handle);
-	struct component_pool *old_comp_pool = &scene->component_handle_pool[old_component_pool_index];
-	struct component_pool *new_comp_pool =
-	    &scene->component_handle_pool[scene->nodes[indirect_index].component_pool_index];
+void
+scene_entity_remove_component(struct arena *arena, struct scene *scene, entity_t entity, component_t components)
+{
+	sm__assert(handle_valid(&scene->nodes_handle_pool, entity.handle));
 
-	for (u64 i = 1; (i - 1) < UINT64_MAX; i <<= 1)
+	struct node *node = &scene->nodes[handle_index(entity.handle)];
+	if ((node->archetype & components) != components)
 	{
-		component_t old_cmp = old_archetype & i;
-		component_t new_cmp = new_archetype & i;
-		if (new_cmp & old_cmp)
-		{
-			u32 cmp_index = fast_log2_64(new_cmp);
-			sm__assert(cmp_index < 64);
-			struct component_view *old_view = &old_comp_pool->view[cmp_index];
-			struct component_view *new_view = &new_comp_pool->view[cmp_index];
-			sm__assert(old_view->id == new_view->id);
-
-			sm__assert(new_index < new_comp_pool->handle_pool.cap);
-			void *dest = (u8 *)new_comp_pool->data + (new_index * new_comp_pool->size) + new_view->offset;
-
-			sm__assert(old_index < old_comp_pool->handle_pool.cap);
-			void *src = (u8 *)old_comp_pool->data + (old_index * old_comp_pool->size) + old_view->offset;
-
-			memcpy(dest, src, new_view->size);
-		}
+		log_warn(str8_from("entity {u6d} does not have {u6d} component"), (u64)entity.handle, components);
+		return;
 	}
 
-	handle_remove(&old_comp_pool->handle_pool, old_handle);
-	memset((u8 *)old_comp_pool->data + (old_index * old_comp_pool->size), 0x0, old_comp_pool->size);
+	u32 comp_pool_index =
+	    sm__scene_archetype_transition(arena, scene, node->component_pool_index, components, false);
+	sm__scene_entity_move(arena, scene, entity, comp_pool_index);
 }
 
-void *
-scene_component_get_data(struct scene *scene, entity_t entity, component_t component)
+const void *
+scene_component_read_data(struct scene *scene, entity_t entity, component_t component)
 {
-	void *result;
+	const void *result;
 	sm__assert(handle_valid(&scene->nodes_handle_pool, entity.handle));
 
 	u32 index = handle_index(entity.handle);
@@ -610,6 +831,19 @@ scene_component_get_data(struct scene *scene, entity_t entity, component_t compo
 	return (result);
 }
 
+void *
+scene_component_get_data(struct scene *scene, entity_t entity, component_t component)
+{
+	void *result = (void *)scene_component_read_data(scene, entity, component);
+
+	const struct node *node = &scene->nodes[handle_index(entity.handle)];
+	const struct component_pool *comp_pool = &scene->component_handle_pool[node->component_pool_index];
+	u32 row = comp_pool->handle_pool.sparse[handle_index(node->handle)];
+	component_pool_mark_changed(comp_pool, row, component, scene->tick);
+
+	return (result);
+}
+
 void
 scene_entity_set_dirty(struct scene *scene, entity_t entity, b32 dirty)
 {
@@ -652,46 +886,33 @@ scene_entity_update_hierarchy(struct scene *scene, entity_t self)
 	if (self_node->parent.handle)
 	{
 		sm__assert(scene_entity_is_valid(scene, self_node->parent));
-		transform_component *parent_transform = scene_component_get_data(scene, self_node->parent, TRANSFORM);
+		const transform_component *parent_transform =
+		    scene_component_read_data(scene, self_node->parent, TRANSFORM);
 
-		glm_mat4_mul(
-		    parent_transform->matrix.data, self_transform->matrix_local.data, self_transform->matrix.data);
+		glm_mat4_mul((vec4 *)parent_transform->matrix.data, self_transform->matrix_local.data,
+		    self_transform->matrix.data);
 	}
 	else
 	{
 		glm_mat4_copy(self_transform->matrix_local.data, self_transform->matrix.data);
 	}
 
-	for (u32 i = 0; i < array_len(self_node->children); ++i)
+	for (entity_t child = self_node->first_child; child.handle != INVALID_HANDLE;
+	     child = scene->nodes[handle_index(child.handle)].next_sibling)
 	{
-		scene_entity_update_hierarchy(scene, self_node->children[i]);
+		scene_entity_update_hierarchy(scene, child);
 	}
 }
 
 b32
 scene_entity_is_descendant_of(struct scene *scene, entity_t self, entity_t entity)
 {
-	u32 self_index = handle_index(self.handle);
-	struct node *self_node = &scene->nodes[self_index];
-
-	if (self_node->parent.handle != INVALID_HANDLE)
+	entity_t ancestor = scene->nodes[handle_index(self.handle)].parent;
+	while (ancestor.handle != INVALID_HANDLE)
 	{
-		return (0);
-	}
-	if (self_node->parent.handle == entity.handle)
-	{
-		return (1);
-	}
+		if (ancestor.handle == entity.handle) { return (1); }
 
-	u32 entity_index = handle_index(entity.handle);
-	struct node *entity_node = &scene->nodes[entity_index];
-
-	for (u32 i = 0; i < array_len(entity_node->children); ++i)
-	{
-		if (scene_entity_is_descendant_of(scene, self, entity_node->children[i]))
-		{
-			return (1);
-		}
+		ancestor = scene->nodes[handle_index(ancestor.handle)].parent;
 	}
 
 	return (0);
@@ -724,70 +945,120 @@ scene_entity_set_parent(struct scene *scene, entity_t self, entity_t new_parent)
 
 	if (new_parent.handle && scene_entity_is_descendant_of(scene, new_parent, self))
 	{
-		for (u32 i = 0; i < array_len(self_node->children); ++i)
+		// the children of self move up to its parent, so the new parent stops being below self
+		struct node *grand_parent_node = 0;
+		entity_t grand_parent = self_node->parent;
+		if (grand_parent.handle) { grand_parent_node = &scene->nodes[handle_index(grand_parent.handle)]; }
+
+		while (self_node->first_child.handle != INVALID_HANDLE)
 		{
-			// self->chidren_transform[i]->parent_transform = self->parent_transform;
-			entity_t motherless = self_node->children[i];
-
-			u32 motherless_index = handle_index(motherless.handle);
-			sm__assert(motherless_index < scene->nodes_handle_pool.cap);
-			sm__assert(scene->nodes[motherless_index].archetype & TRANSFORM);
-			struct node *motherless_node = &scene->nodes[motherless_index];
-			motherless_node->parent = self_node->parent;
+			struct node *motherless_node = &scene->nodes[handle_index(self_node->first_child.handle)];
+			sm__scene_node_detach(scene, motherless_node);
+			if (grand_parent_node) { sm__scene_node_attach(scene, motherless_node, grand_parent_node); }
+			motherless_node->flags |= HIERARCHY_FLAG_DIRTY;
 		}
-
-		array_set_len(scene->arena, self_node->children, 0);
 	}
 
-	if (self_node->parent.handle)
+	sm__scene_node_detach(scene, self_node);
+
+	if (new_parent.handle)
 	{
-		entity_t parent_entity = self_node->parent;
+		u32 new_parent_index = handle_index(new_parent.handle);
+		sm__assert(new_parent_index < scene->nodes_handle_pool.cap);
+		struct node *new_parent_node = &scene->nodes[new_parent_index];
+
+		sm__scene_node_attach(scene, self_node, new_parent_node);
+		new_parent_node->flags |= HIERARCHY_FLAG_DIRTY;
+	}
+
+	self_node->flags |= HIERARCHY_FLAG_DIRTY;
+
+	scene->hierarchy_stale = true;
+}
+
+static void
+sm__scene_hierarchy_rebuild(struct scene *scene)
+{
+	struct handle_pool *nodes_pool = &scene->nodes_handle_pool;
 
-		u32 parent_index = handle_index(parent_entity.handle);
-		sm__assert(parent_index < scene->nodes_handle_pool.cap);
-		sm__assert(scene->nodes[parent_index].archetype & TRANSFORM);
-		struct node *parent_node = &scene->nodes[parent_index];
+	array_set_len(scene->arena, scene->hierarchy, 0);
+	for (u32 i = 0; i < nodes_pool->len; ++i)
+	{
+		entity_t entity = {handle_at(nodes_pool, i)};
+		const struct node *node = &scene->nodes[handle_index(entity.handle)];
+		if (!(node->archetype & TRANSFORM)) { continue; }
+
+		// a parent that lost its transform no longer takes part, its children are roots
+		entity_t parent = node->parent;
+		b32 has_parent = parent.handle != INVALID_HANDLE &&
+				 (scene->nodes[handle_index(parent.handle)].archetype & TRANSFORM);
+		if (has_parent) { continue; }
+
+		struct hierarchy_entry root = {.entity = entity, .parent = HIERARCHY_ROOT};
+		array_push(scene->arena, scene->hierarchy, root);
+	}
 
-		i32 new_self_index = -1;
-		for (u32 i = 0; i < array_len(parent_node->children); ++i)
+	// the array is its own queue: appending the children of every entry while walking it is a breadth first walk
+	for (u32 i = 0; i < array_len(scene->hierarchy); ++i)
+	{
+		const struct node *node = &scene->nodes[handle_index(scene->hierarchy[i].entity.handle)];
+		for (entity_t child = node->first_child; child.handle != INVALID_HANDLE;
+		     child = scene->nodes[handle_index(child.handle)].next_sibling)
 		{
-			if (self_node->self.handle == parent_node->children[i].handle)
-			{
-				new_self_index = i;
-				break;
-			}
-		}
-		sm__assert(new_self_index != -1);
+			if (!(scene->nodes[handle_index(child.handle)].archetype & TRANSFORM)) { continue; }
 
-		array_del(parent_node->children, new_self_index, 1);
+			struct hierarchy_entry entry = {.entity = child, .parent = i};
+			array_push(scene->arena, scene->hierarchy, entry);
+		}
 	}
 
-	// Push self as child of the new parent
-	if (new_parent.handle)
+	array_set_len(scene->arena, scene->hierarchy_transforms, array_len(scene->hierarchy));
+	scene->hierarchy_stale = false;
+}
+
+void
+scene_hierarchy_update(struct scene *scene)
+{
+	if (scene->hierarchy_stale) { sm__scene_hierarchy_rebuild(scene); }
+
+	u32 count = array_len(scene->hierarchy);
+	if (count == 0) { return; }
+
+	// transforms written by the pass, 0 for the entries left alone
+	transform_component **transforms = scene->hierarchy_transforms;
+
+	for (u32 i = 0; i < count; ++i)
 	{
-		b32 is_child = 0;
+		const struct hierarchy_entry *entry = &scene->hierarchy[i];
+		const struct node *node = &scene->nodes[handle_index(entry->entity.handle)];
 
-		u32 new_parent_index = handle_index(new_parent.handle);
-		struct node *new_parent_node = &scene->nodes[new_parent_index];
+		b32 parent_dirty = entry->parent != HIERARCHY_ROOT && transforms[entry->parent] != 0;
+		if (!parent_dirty && !(node->flags & HIERARCHY_FLAG_DIRTY))
+		{
+			transforms[i] = 0;
+			continue;
+		}
 
-		for (u32 i = 0; i < array_len(new_parent_node->children); ++i)
+		transform_component *transform = scene_component_get_data(scene, entry->entity, TRANSFORM);
+		transform->matrix_local = trs_to_m4(transform->transform_local);
+
+		if (entry->parent == HIERARCHY_ROOT)
 		{
-			if (new_parent_node->children[i].handle == self_node->self.handle)
-			{
-				is_child = 1;
-				break;
-			}
+			glm_mat4_copy(transform->matrix_local.data, transform->matrix.data);
 		}
-		if (!is_child)
+		else
 		{
-			array_push(scene->arena, new_parent_node->children, self);
+			// a clean parent still has a valid world matrix, it only has to be looked up
+			entity_t parent_entity = scene->hierarchy[entry->parent].entity;
+			const transform_component *parent = transforms[entry->parent];
+			if (!parent_dirty) { parent = scene_component_read_data(scene, parent_entity, TRANSFORM); }
+
+			// glm_mat4_mul goes through SSE or AVX when the target has them
+			glm_mat4_mul((vec4 *)parent->matrix.data, transform->matrix_local.data, transform->matrix.data);
 		}
-		new_parent_node->flags |= HIERARCHY_FLAG_DIRTY;
-	}
 
-	// Set the new parent in self
-	self_node->parent = new_parent;
-	self_node->flags |= HIERARCHY_FLAG_DIRTY;
+		transforms[i] = transform;
+	}
 }
 
 void
@@ -808,7 +1079,7 @@ scene_entity_set_position_local(struct scene *scene, entity_t self, v3 position)
 
 	glm_vec3_copy(position.data, self_transform->transform_local.translation.data);
 
-	scene_entity_update_hierarchy(scene, self);
+	scene_entity_set_dirty(scene, self, 1);
 }
 
 void
@@ -823,10 +1094,11 @@ scene_entity_set_position(struct scene *scene, entity_t self, v3 position)
 	}
 	else
 	{
-		transform_component *parent_transform = scene_component_get_data(scene, self_node->parent, TRANSFORM);
+		const transform_component *parent_transform =
+		    scene_component_read_data(scene, self_node->parent, TRANSFORM);
 		m4 inv;
 
-		glm_mat4_inv(parent_transform->matrix.data, inv.data);
+		glm_mat4_inv((vec4 *)parent_transform->matrix.data, inv.data);
 		position = m4_v3(inv, position);
 
 		scene_entity_set_position_local(scene, self, position);
@@ -844,7 +1116,7 @@ scene_entity_set_rotation_local(struct scene *scene, entity_t self, v4 rotation)
 
 	glm_vec4_copy(rotation.data, self_transform->transform_local.rotation.data);
 
-	scene_entity_update_hierarchy(scene, self);
+	scene_entity_set_dirty(scene, self, 1);
 }
 
 void
@@ -860,8 +1132,9 @@ scene_entity_set_rotation(struct scene *scene, entity_t self, v4 rotation)
 	else
 	{
 		v4 inv;
-		transform_component *parent_transform = scene_component_get_data(scene, self_node->parent, TRANSFORM);
-		glm_mat4_quat(parent_transform->matrix.data, inv.data);
+		const transform_component *parent_transform =
+		    scene_component_read_data(scene, self_node->parent, TRANSFORM);
+		glm_mat4_quat((vec4 *)parent_transform->matrix.data, inv.data);
 		glm_quat_inv(inv.data, inv.data);
 
 		glm_quat_mul(rotation.data, inv.data, rotation.data);
@@ -885,7 +1158,7 @@ scene_entity_set_scale_local(struct scene *scene, entity_t self, v3 scale)
 
 	glm_vec3_copy(scale.data, self_transform->transform_local.scale.data);
 
-	scene_entity_update_hierarchy(scene, self);
+	scene_entity_set_dirty(scene, self, 1);
 }
 
 void
@@ -900,18 +1173,19 @@ scene_entity_translate(struct scene *scene, entity_t self, v3 delta)
 		glm_vec3_add(self_transform->transform_local.translation.data, delta.data,
 		    self_transform->transform_local.translation.data);
 
-		scene_entity_update_hierarchy(scene, self);
+		scene_entity_set_dirty(scene, self, 1);
 	}
 	else
 	{
-		transform_component *parent_transform = scene_component_get_data(scene, self_node->parent, TRANSFORM);
+		const transform_component *parent_transform =
+		    scene_component_read_data(scene, self_node->parent, TRANSFORM);
 		m4 inv;
-		glm_mat4_inv(parent_transform->matrix.data, inv.data);
+		glm_mat4_inv((vec4 *)parent_transform->matrix.data, inv.data);
 		delta = m4_v3(inv, delta);
 		glm_vec3_add(self_transform->transform_local.translation.data, delta.data,
 		    self_transform->transform_local.translation.data);
 
-		scene_entity_update_hierarchy(scene, self);
+		scene_entity_set_dirty(scene, self, 1);
 	}
 }
 
@@ -928,22 +1202,25 @@ scene_entity_rotate(struct scene *scene, entity_t self, v4 delta)
 		    self_transform->transform_local.rotation.data);
 		glm_quat_normalize(self_transform->transform_local.rotation.data);
 
-		scene_entity_update_hierarchy(scene, self);
+		scene_entity_set_dirty(scene, self, 1);
 	}
 	else
 	{
-		// TODO: investigate this
+		// delta is in world space: bring it into the parent space, the world matrix of self can be stale here
+		const transform_component *parent_transform =
+		    scene_component_read_data(scene, self_node->parent, TRANSFORM);
 		v4 inv, q;
 		m4 rotation_matrix;
 		v3 discard;
 
-		glm_decompose_rs(self_transform->matrix.data, rotation_matrix.data, discard.data);
+		glm_decompose_rs((vec4 *)parent_transform->matrix.data, rotation_matrix.data, discard.data);
 		glm_mat4_quat(rotation_matrix.data, q.data);
 
 		glm_quat_inv(q.data, inv.data);
-		glm_quat_mul(self_transform->transform_local.rotation.data, inv.data, inv.data);
 		glm_quat_mul(inv.data, delta.data, delta.data);
-		glm_quat_mul(delta.data, q.data, q.data);
+		glm_quat_mul(delta.data, q.data, delta.data);
+		glm_quat_mul(delta.data, self_transform->transform_local.rotation.data, q.data);
+		glm_quat_normalize(q.data);
 
 		scene_entity_set_rotation_local(scene, self, q);
 	}
@@ -951,6 +1228,13 @@ scene_entity_rotate(struct scene *scene, entity_t self, v4 delta)
 
 void
 scene_system_register(struct arena *arena, struct scene *scene, str8 name, system_f system, void *user_data)
+{
+	scene_system_register_access(arena, scene, name, system, user_data, SYSTEM_ACCESS_ALL, SYSTEM_ACCESS_ALL);
+}
+
+void
+scene_system_register_access(struct arena *arena, struct scene *scene, str8 name, system_f system, void *user_data,
+    component_t read, component_t write)
 {
 	sm__assert(system);
 
@@ -959,39 +1243,86 @@ scene_system_register(struct arena *arena, struct scene *scene, str8 name, syste
 
 	    .system = system,
 	    .user_data = user_data,
+
+	    .read = read,
+	    .write = write,
+
+	    .last_run = 0,
 	};
 
 	array_push(arena, scene->sys_info, sys_info);
 }
 
-struct scene_iter
-scene_iter_begin(struct scene *scene, component_t constraint)
+// pool the iterator visits at cursor, or 0 past the last one. Without a query every pool is a candidate and cursor
+// skips the ones not matching constraint
+static const struct component_pool *
+sm__scene_iter_pool(const struct scene *scene, u32 query_index, component_t constraint, u32 *cursor)
 {
-	struct scene_iter result;
+	if (query_index != SCENE_QUERY_NONE)
+	{
+		const struct scene_query *query = &scene->queries[query_index];
+		if (*cursor >= array_len(query->comp_pools)) { return (0); }
 
-	result.constraint = constraint;
-	result.index = 0;
-	result.comp_pool_index = 0;
-	result.comp_pool_ref = 0;
-	result.first_iter = 1;
-	result.scene_ref = scene;
+		return (&scene->component_handle_pool[query->comp_pools[*cursor]]);
+	}
 
-	for (u32 i = result.comp_pool_index; i < array_len(scene->component_handle_pool); ++i)
+	for (; *cursor < array_len(scene->component_handle_pool); ++(*cursor))
 	{
-		component_t archetype = scene->component_handle_pool[i].archetype;
-		if ((result.constraint & archetype) == result.constraint)
-		{
-			result.comp_pool_index = i;
-			result.comp_pool_ref = &scene->component_handle_pool[i];
-			break;
-		}
+		const struct component_pool *cpool = &scene->component_handle_pool[*cursor];
+		if ((cpool->archetype & constraint) == constraint) { return (cpool); }
 	}
 
-	return (result);
+	return (0);
 }
 
-b32
-scene_iter_next(struct scene *scene, struct scene_iter *iter)
+static struct scene_iter
+sm__scene_iter_begin(struct scene *scene, u32 query_index, component_t constraint)
+{
+	struct scene_iter result;
+
+	result.constraint = constraint;
+	result.query_index = query_index;
+	result.index = 0;
+	result.comp_pool_index = 0;
+	result.first_iter = 1;
+	result.scene_ref = scene;
+	result.comp_pool_ref = sm__scene_iter_pool(scene, query_index, constraint, &result.comp_pool_index);
+	result.changed = 0;
+	result.since = 0;
+
+	return (result);
+}
+
+static b32
+sm__scene_chunk_changed(const struct component_pool *cpool, u32 chunk, component_t changed, u32 since)
+{
+	for (component_t bits = changed; bits; bits &= bits - 1)
+	{
+		if (component_pool_get_chunk_version(cpool, chunk, bits & (~bits + 1)) > since) { return (1); }
+	}
+
+	return (0);
+}
+
+static b32
+sm__scene_row_changed(const struct component_pool *cpool, u32 row, component_t changed, u32 since)
+{
+	for (component_t bits = changed; bits; bits &= bits - 1)
+	{
+		if (component_pool_get_row_version(cpool, row, bits & (~bits + 1)) > since) { return (1); }
+	}
+
+	return (0);
+}
+
+struct scene_iter
+scene_iter_begin(struct scene *scene, component_t constraint)
+{
+	return (sm__scene_iter_begin(scene, SCENE_QUERY_NONE, constraint));
+}
+
+b32
+scene_iter_next(struct scene *scene, struct scene_iter *iter)
 {
 	if (!iter->comp_pool_ref)
 	{
@@ -1008,56 +1339,62 @@ scene_iter_next(struct scene *scene, struct scene_iter *iter)
 		iter->first_iter = 0;
 	}
 
-	while (iter->index < iter->comp_pool_ref->handle_pool.len)
+	while (true)
 	{
-		handle_t handle = handle_at(&iter->comp_pool_ref->handle_pool, iter->index);
-		if (handle_valid(&iter->comp_pool_ref->handle_pool, handle))
-		{
-			return (1);
-		}
-		else
+		const struct component_pool *cpool = iter->comp_pool_ref;
+
+		// rows are dense, the first row past len ends the pool
+		if (iter->index >= cpool->handle_pool.len)
 		{
-			iter->index++;
+			iter->comp_pool_index++;
+			iter->comp_pool_ref =
+			    sm__scene_iter_pool(scene, iter->query_index, iter->constraint, &iter->comp_pool_index);
+			iter->index = 0;
+
+			if (!iter->comp_pool_ref) { return (0); }
+			continue;
 		}
-	}
 
-	iter->comp_pool_index++;
+		if (!iter->changed) { return (1); }
 
-	for (u32 i = iter->comp_pool_index; i < array_len(scene->component_handle_pool); ++i)
-	{
-		const struct component_pool *cpool = &scene->component_handle_pool[i];
-		component_t archetype = cpool->archetype;
-		if ((archetype & iter->constraint) == iter->constraint)
+		u32 chunk = iter->index / cpool->chunk_capacity;
+		if (!sm__scene_chunk_changed(cpool, chunk, iter->changed, iter->since))
 		{
-			if (cpool->handle_pool.len > 0)
-			{
-				iter->index = 0;
-				iter->comp_pool_ref = cpool;
-				iter->comp_pool_index = i;
-
-				return (1);
-			}
+			iter->index = (chunk + 1) * cpool->chunk_capacity;
 		}
+		else if (sm__scene_row_changed(cpool, iter->index, iter->changed, iter->since)) { return (1); }
+		else { iter->index++; }
 	}
+}
 
-	return (0);
+void
+scene_iter_filter_changed(struct scene_iter *iter, component_t changed, u32 since)
+{
+	sm__assert(iter->first_iter);
+	sm__assert((iter->constraint & changed) == changed);
+
+	iter->changed = changed;
+	iter->since = since;
 }
 
-void *
-scene_iter_get_component(struct scene_iter *iter, component_t component)
+const void *
+scene_iter_read_component(struct scene_iter *iter, component_t component)
 {
-	void *result = 0;
+	const void *result = 0;
 
 	sm__assert((iter->constraint & component) == component);
 
-	u32 comp_index = fast_log2_64(component);
-	sm__assert(comp_index < 64);
+	result = component_pool_get_row_data(iter->comp_pool_ref, iter->index, component);
 
-	const struct component_view *v = &iter->comp_pool_ref->view[comp_index];
-	sm__assert(component == v->id);
+	return (result);
+}
 
-	// If the view has the specified component, return a pointer to its data
-	result = (u8 *)iter->comp_pool_ref->data + (iter->index * iter->comp_pool_ref->size) + v->offset;
+void *
+scene_iter_get_component(struct scene_iter *iter, component_t component)
+{
+	void *result = (void *)scene_iter_read_component(iter, component);
+
+	component_pool_mark_changed(iter->comp_pool_ref, iter->index, component, iter->scene_ref->tick);
 
 	return (result);
 }
@@ -1065,47 +1402,142 @@ scene_iter_get_component(struct scene_iter *iter, component_t component)
 entity_t
 scene_iter_get_entity(struct scene_iter *iter)
 {
-	entity_t result = {INVALID_HANDLE};
+	entity_t result;
 
-	struct node *nodes = iter->scene_ref->nodes;
-	const struct scene *scene = iter->scene_ref;
+	result.handle = component_pool_get_owner(iter->comp_pool_ref, iter->index);
 
-	for (u32 i = 0; i < scene->nodes_handle_pool.len; ++i)
-	{
-		handle_t entity_handle = handle_at(&scene->nodes_handle_pool, i);
-		u32 index = handle_index(entity_handle);
-		if (nodes[index].archetype == iter->comp_pool_ref->archetype)
-		{
-			handle_t handle = handle_at(&iter->comp_pool_ref->handle_pool, iter->index);
-			if (nodes[index].handle == handle)
-			{
-				result.handle = entity_handle;
-				break;
-			}
-		}
-	}
+	return (result);
+}
 
-	sm__assert(result.handle != INVALID_HANDLE);
+static b32
+sm__scene_system_conflicts(const struct system_info *a, const struct system_info *b)
+{
+	b32 result = (a->write & (b->read | b->write)) != 0 || (b->write & a->read) != 0;
 
 	return (result);
 }
 
+struct sm__scene_system_level
+{
+	struct arena *arena;
+	struct scene *scene;
+	struct ctx *ctx;
+
+	u32 *systems; // indices into scene->sys_info
+	b32 *results;
+};
+
+// last_run of the system running on the thread, and where it is recording commands from
+static _Thread_local u32 sm__scene_system_since;
+static _Thread_local u32 sm__scene_system_index = SCENE_SYSTEM_NONE;
+static _Thread_local u32 sm__scene_system_range;
+
+static b32
+sm__scene_system_call(struct arena *arena, struct scene *scene, struct ctx *ctx, struct system_info *info)
+{
+	// a system waiting on jobs may run another system of its level on the same thread, keep the outer values
+	u32 outer_since = sm__scene_system_since;
+	u32 outer_index = sm__scene_system_index;
+	u32 outer_range = sm__scene_system_range;
+	sm__scene_system_since = info->last_run;
+	sm__scene_system_index = (u32)(info - scene->sys_info);
+	sm__scene_system_range = 0;
+
+	b32 result = info->system(arena, scene, ctx, info->user_data);
+
+	info->last_run = scene->tick;
+	sm__scene_system_since = outer_since;
+	sm__scene_system_index = outer_index;
+	sm__scene_system_range = outer_range;
+
+	return (result);
+}
+
+u32
+scene_system_last_run(void)
+{
+	return (sm__scene_system_since);
+}
+
+static void
+sm__scene_system_job(void *user_data, u32 index)
+{
+	struct sm__scene_system_level *level = user_data;
+	struct system_info *info = &level->scene->sys_info[level->systems[index]];
+
+	// the frame arena is per thread, hand the system the one of the thread it landed on
+	struct ctx ctx = *level->ctx;
+	ctx.frame = frame_arena_get();
+
+	level->results[index] = sm__scene_system_call(level->arena, level->scene, &ctx, info);
+}
+
 void
 scene_system_run(struct arena *arena, struct scene *scene, struct ctx *ctx)
 {
-	// log_debug(str8_from("System running:"));
-	for (u32 i = 0; i < array_len(scene->sys_info); ++i)
+	u32 system_count = array_len(scene->sys_info);
+	if (system_count == 0) { return; }
+
+	// the graph is rebuilt every frame, it is a handful of mask tests per pair of systems
+	u32 *levels = frame_alloc(system_count * sizeof(u32));
+	u32 level_count = 0;
+	for (u32 i = 0; i < system_count; ++i)
+	{
+		levels[i] = 0;
+		for (u32 j = 0; j < i; ++j)
+		{
+			if (levels[j] >= levels[i] &&
+			    sm__scene_system_conflicts(&scene->sys_info[i], &scene->sys_info[j]))
+			{
+				levels[i] = levels[j] + 1;
+			}
+		}
+		level_count = MAX(level_count, levels[i] + 1);
+	}
+
+	struct sm__scene_system_level level = {
+	    .arena = arena,
+	    .scene = scene,
+	    .ctx = ctx,
+	    .systems = frame_alloc(system_count * sizeof(u32)),
+	    .results = frame_alloc(system_count * sizeof(b32)),
+	};
+
+	for (u32 l = 0; l < level_count; ++l)
 	{
-		system_f system = scene->sys_info[i].system;
-		void *user_data = scene->sys_info[i].user_data;
-		// str8 name = scene->sys_info[i].name;
-		// log_debug(str8_from("    - {s}"), name);
+		u32 count = 0;
+		for (u32 i = 0; i < system_count; ++i)
+		{
+			if (levels[i] == l) { level.systems[count++] = i; }
+		}
+
+		scene->tick++;
 
-		if (!system(arena, scene, ctx, user_data))
+		b32 keep_running = true;
+		if (count == 1)
 		{
-			break;
+			// alone in its level, run it on the calling thread. Systems registered without access masks
+			// always end up here, so they never leave the main thread
+			struct system_info *info = &scene->sys_info[level.systems[0]];
+			keep_running = sm__scene_system_call(arena, scene, ctx, info);
 		}
+		else
+		{
+			struct job_counter counter = {0};
+			job_submit(ctx->jobs, &counter, sm__scene_system_job, &level, count);
+			job_wait(ctx->jobs, &counter);
+
+			for (u32 i = 0; i < count; ++i) { keep_running = keep_running && level.results[i]; }
+		}
+
+		// sync point, the level after this one sees the changes its systems recorded
+		scene_command_playback(arena, scene);
+
+		if (!keep_running) { break; }
 	}
+
+	// writes made between two runs must be newer than the last level
+	scene->tick++;
 }
 
 void
@@ -1159,6 +1591,598 @@ scene_on_draw(struct arena *arena, struct scene *scene, struct ctx *ctx)
 	scene->draw(arena, scene, ctx, scene->user_data);
 }
 
+struct scene_chunk_iter
+scene_chunk_iter_begin(struct scene *scene, component_t constraint)
+{
+	struct scene_chunk_iter result = {
+	    .scene_ref = scene,
+	    .constraint = constraint,
+	    .query_index = SCENE_QUERY_NONE,
+	    .changed = 0,
+	    .since = 0,
+	};
+
+	return (result);
+}
+
+b32
+scene_chunk_iter_next(struct scene_chunk_iter *iter)
+{
+	const struct scene *scene = iter->scene_ref;
+
+	const struct component_pool *cpool;
+	while ((cpool = sm__scene_iter_pool(scene, iter->query_index, iter->constraint, &iter->comp_pool_index)))
+	{
+		u32 first_row = iter->chunk_index * cpool->chunk_capacity;
+		if (first_row < cpool->handle_pool.len && iter->changed &&
+		    !sm__scene_chunk_changed(cpool, iter->chunk_index, iter->changed, iter->since))
+		{
+			iter->chunk_index++;
+			continue;
+		}
+
+		if (first_row < cpool->handle_pool.len)
+		{
+			iter->comp_pool_ref = cpool;
+			iter->first_row = first_row;
+			iter->count = MIN(cpool->chunk_capacity, cpool->handle_pool.len - first_row);
+			iter->chunk_index++;
+
+			return (1);
+		}
+
+		iter->chunk_index = 0;
+		iter->comp_pool_index++;
+	}
+
+	return (0);
+}
+
+void
+scene_chunk_iter_filter_changed(struct scene_chunk_iter *iter, component_t changed, u32 since)
+{
+	sm__assert(iter->chunk_index == 0 && iter->comp_pool_index == 0);
+	sm__assert((iter->constraint & changed) == changed);
+
+	iter->changed = changed;
+	iter->since = since;
+}
+
+const void *
+scene_chunk_iter_read_column(struct scene_chunk_iter *iter, component_t component)
+{
+	const void *result;
+
+	sm__assert((iter->constraint & component) == component);
+	sm__assert(iter->chunk_index > 0);
+
+	result = component_pool_get_column(iter->comp_pool_ref, iter->chunk_index - 1, component);
+
+	return (result);
+}
+
+void *
+scene_chunk_iter_get_column(struct scene_chunk_iter *iter, component_t component)
+{
+	void *result = (void *)scene_chunk_iter_read_column(iter, component);
+
+	u32 end = iter->first_row + iter->count;
+	component_pool_mark_rows_changed(iter->comp_pool_ref, iter->first_row, end, component, iter->scene_ref->tick);
+
+	return (result);
+}
+
+const entity_t *
+scene_chunk_iter_get_entities(struct scene_chunk_iter *iter)
+{
+	const entity_t *result;
+
+	sm__assert(iter->chunk_index > 0);
+
+	result = (const entity_t *)component_pool_get_owner_column(iter->comp_pool_ref, iter->chunk_index - 1);
+
+	return (result);
+}
+
+struct sm__scene_iter_parallel
+{
+	scene_iter_parallel_f fn;
+	void *user_data;
+
+	// of the system iterating, the ranges stand in for it on whichever thread runs them
+	u32 since;
+	u32 system;
+
+	struct scene_iter_range *ranges;
+};
+
+static void
+sm__scene_iter_parallel_job(void *user_data, u32 index)
+{
+	struct sm__scene_iter_parallel *parallel = user_data;
+
+	u32 outer_since = sm__scene_system_since;
+	u32 outer_index = sm__scene_system_index;
+	u32 outer_range = sm__scene_system_range;
+	sm__scene_system_since = parallel->since;
+	sm__scene_system_index = parallel->system;
+	sm__scene_system_range = index + 1;
+
+	parallel->fn(&parallel->ranges[index], parallel->user_data);
+
+	sm__scene_system_since = outer_since;
+	sm__scene_system_index = outer_index;
+	sm__scene_system_range = outer_range;
+}
+
+static void
+sm__scene_iter_parallel(
+    struct scene *scene, u32 query_index, component_t constraint, scene_iter_parallel_f fn, void *user_data)
+{
+	struct sm__scene_iter_parallel parallel = {
+	    .fn = fn,
+	    .user_data = user_data,
+	    .since = sm__scene_system_since,
+	    .system = sm__scene_system_index,
+	};
+
+	u32 range_count = 0;
+	for (u32 pass = 0; pass < 2; ++pass)
+	{
+		// first pass counts the ranges, second one fills them
+		if (pass == 1)
+		{
+			if (range_count == 0) { return; }
+			parallel.ranges = frame_alloc(range_count * sizeof(struct scene_iter_range));
+			range_count = 0;
+		}
+
+		const struct component_pool *cpool;
+		for (u32 i = 0; (cpool = sm__scene_iter_pool(scene, query_index, constraint, &i)); ++i)
+		{
+			u32 len = cpool->handle_pool.len;
+			u32 chunk = cpool->chunk_capacity;
+			for (u32 begin = 0; begin < len; begin += chunk)
+			{
+				if (pass == 1)
+				{
+					parallel.ranges[range_count] = (struct scene_iter_range){
+					    .comp_pool_ref = cpool,
+					    .view = cpool->view,
+					    .begin = begin,
+					    .end = MIN(begin + chunk, len),
+					    .tick = scene->tick,
+					};
+				}
+				range_count++;
+			}
+		}
+	}
+
+	struct job_system *jobs = job_system_get();
+	struct job_counter counter = {0};
+	job_submit(jobs, &counter, sm__scene_iter_parallel_job, &parallel, range_count);
+	job_wait(jobs, &counter);
+}
+
+void
+scene_iter_parallel(struct scene *scene, component_t constraint, scene_iter_parallel_f fn, void *user_data)
+{
+	sm__scene_iter_parallel(scene, SCENE_QUERY_NONE, constraint, fn, user_data);
+}
+
+const void *
+scene_iter_range_read_component(const struct scene_iter_range *range, u32 index, component_t component)
+{
+	const void *result = 0;
+
+	sm__assert(index >= range->begin && index < range->end);
+
+	result = component_pool_get_row_data(range->comp_pool_ref, index, component);
+
+	return (result);
+}
+
+void *
+scene_iter_range_get_component(const struct scene_iter_range *range, u32 index, component_t component)
+{
+	void *result = (void *)scene_iter_range_read_component(range, index, component);
+
+	component_pool_mark_changed(range->comp_pool_ref, index, component, range->tick);
+
+	return (result);
+}
+
+const void *
+scene_iter_range_read_column(const struct scene_iter_range *range, component_t component)
+{
+	const void *result;
+
+	const struct component_pool *cpool = range->comp_pool_ref;
+	sm__assert(range->begin / cpool->chunk_capacity == (range->end - 1) / cpool->chunk_capacity);
+
+	result = component_pool_get_row_data(cpool, range->begin, component);
+
+	return (result);
+}
+
+void *
+scene_iter_range_get_column(const struct scene_iter_range *range, component_t component)
+{
+	void *result = (void *)scene_iter_range_read_column(range, component);
+
+	component_pool_mark_rows_changed(range->comp_pool_ref, range->begin, range->end, component, range->tick);
+
+	return (result);
+}
+
+entity_t
+scene_iter_range_get_entity(const struct scene_iter_range *range, u32 index)
+{
+	entity_t result;
+
+	sm__assert(index >= range->begin && index < range->end);
+
+	result.handle = component_pool_get_owner(range->comp_pool_ref, index);
+
+	return (result);
+}
+
+query_t
+scene_query_register(struct arena *arena, struct scene *scene, component_t with, component_t without)
+{
+	query_t result;
+
+	sm__assert((with & without) == 0);
+
+	for (u32 i = 0; i < array_len(scene->queries); ++i)
+	{
+		if (scene->queries[i].with == with && scene->queries[i].without == without)
+		{
+			result.index = i;
+			return (result);
+		}
+	}
+
+	struct scene_query query = {.with = with, .without = without};
+	for (u32 i = 0; i < array_len(scene->component_handle_pool); ++i)
+	{
+		if (sm__scene_query_matches(&query, scene->component_handle_pool[i].archetype))
+		{
+			array_push(arena, query.comp_pools, i);
+		}
+	}
+
+	array_push(arena, scene->queries, query);
+	result.index = array_len(scene->queries) - 1;
+
+	return (result);
+}
+
+struct scene_iter
+scene_query_iter_begin(struct scene *scene, query_t query)
+{
+	sm__assert(query.index < array_len(scene->queries));
+
+	return (sm__scene_iter_begin(scene, query.index, scene->queries[query.index].with));
+}
+
+struct scene_chunk_iter
+scene_query_chunk_iter_begin(struct scene *scene, query_t query)
+{
+	sm__assert(query.index < array_len(scene->queries));
+
+	struct scene_chunk_iter result = {
+	    .scene_ref = scene,
+	    .constraint = scene->queries[query.index].with,
+	    .query_index = query.index,
+	};
+
+	return (result);
+}
+
+void
+scene_query_iter_parallel(struct scene *scene, query_t query, scene_iter_parallel_f fn, void *user_data)
+{
+	sm__assert(query.index < array_len(scene->queries));
+
+	sm__scene_iter_parallel(scene, query.index, scene->queries[query.index].with, fn, user_data);
+}
+
+// a pending entity is the position of its creation among the ones of its buffer, counting from 1. Generation 0 is
+// never handed out by the handle pool so it cannot be mistaken for a live entity
+#define SCENE_COMMAND_IS_PENDING(_handle) ((_handle) != INVALID_HANDLE && (handle_t)handle_index(_handle) == (_handle))
+
+static struct scene_command *
+sm__scene_command_push(struct scene *scene, u32 type, entity_t entity, component_t components)
+{
+	struct scene_command_buffer *buffer = &scene->commands[job_thread_index()];
+
+	struct scene_command_block *block = buffer->last;
+	if (block == 0 || block->len == SCENE_COMMAND_BLOCK_COUNT)
+	{
+		block = frame_alloc(sizeof(struct scene_command_block));
+		block->next = 0;
+		block->len = 0;
+
+		if (buffer->last) { buffer->last->next = block; }
+		else { buffer->first = block; }
+		buffer->last = block;
+	}
+
+	struct scene_command *result = &block->commands[block->len++];
+	*result = (struct scene_command){
+	    .type = type,
+	    .entity = entity,
+	    .components = components,
+	    .system = sm__scene_system_index,
+	    .range = sm__scene_system_range,
+	};
+	buffer->count++;
+
+	return (result);
+}
+
+entity_t
+scene_command_entity_new(struct scene *scene, component_t archetype)
+{
+	struct scene_command_buffer *buffer = &scene->commands[job_thread_index()];
+
+	entity_t result = {(handle_t)++buffer->created};
+	sm__assert(result.handle <= sm__handle_index_mask);
+
+	sm__scene_command_push(scene, SCENE_COMMAND_ENTITY_NEW, result, archetype);
+
+	return (result);
+}
+
+void
+scene_command_entity_remove(struct scene *scene, entity_t entity)
+{
+	sm__assert(entity.handle != INVALID_HANDLE);
+
+	sm__scene_command_push(scene, SCENE_COMMAND_ENTITY_REMOVE, entity, 0);
+}
+
+void
+scene_command_add_component(struct scene *scene, entity_t entity, component_t components)
+{
+	sm__assert(entity.handle != INVALID_HANDLE && components != 0);
+
+	sm__scene_command_push(scene, SCENE_COMMAND_ADD_COMPONENT, entity, components);
+}
+
+void
+scene_command_remove_component(struct scene *scene, entity_t entity, component_t components)
+{
+	sm__assert(entity.handle != INVALID_HANDLE && components != 0);
+
+	sm__scene_command_push(scene, SCENE_COMMAND_REMOVE_COMPONENT, entity, components);
+}
+
+void
+scene_command_set_component(struct scene *scene, entity_t entity, component_t component, const void *data)
+{
+	sm__assert(entity.handle != INVALID_HANDLE);
+	sm__assert(component != 0 && (component & (component - 1)) == 0);
+
+	u32 size = ctable_components[fast_log2_64(component)].size;
+
+	struct scene_command *command = sm__scene_command_push(scene, SCENE_COMMAND_SET_COMPONENT, entity, component);
+	command->data = frame_alloc(size);
+	memcpy(command->data, data, size);
+}
+
+// the commands of one system and range are all in the buffer of the thread that ran it, so position (buffer after
+// buffer) only has to order them among themselves and the order does not depend on the threads
+static i32
+sm__scene_command_order(const struct scene_command *lhs, u32 lhs_position, const struct scene_command *rhs,
+    u32 rhs_position)
+{
+	if (lhs->system != rhs->system) { return (lhs->system < rhs->system ? -1 : 1); }
+	if (lhs->range != rhs->range) { return (lhs->range < rhs->range ? -1 : 1); }
+
+	return ((lhs_position > rhs_position) - (lhs_position < rhs_position));
+}
+
+struct sm__scene_command_key
+{
+	handle_t handle;
+	u32 position; // recording order, buffer after buffer
+	struct scene_command *command;
+};
+
+static i32
+sm__scene_command_compare(const void *a, const void *b)
+{
+	const struct sm__scene_command_key *lhs = a;
+	const struct sm__scene_command_key *rhs = b;
+
+	if (lhs->handle != rhs->handle) { return (lhs->handle < rhs->handle ? -1 : 1); }
+
+	return (sm__scene_command_order(lhs->command, lhs->position, rhs->command, rhs->position));
+}
+
+struct sm__scene_pending
+{
+	b32 removed;
+	component_t archetype; // at creation, with the later additions and removals folded in
+	u32 index;	       // of the pending entity, its handle minus one
+	u32 position;	       // of its creation command, buffer after buffer
+	const struct scene_command *command;
+};
+
+// removed last so that the creations form one run per archetype
+static i32
+sm__scene_pending_compare(const void *a, const void *b)
+{
+	const struct sm__scene_pending *lhs = a;
+	const struct sm__scene_pending *rhs = b;
+
+	if (lhs->removed != rhs->removed) { return (lhs->removed ? 1 : -1); }
+	if (lhs->archetype != rhs->archetype) { return (lhs->archetype < rhs->archetype ? -1 : 1); }
+
+	return (sm__scene_command_order(lhs->command, lhs->position, rhs->command, rhs->position));
+}
+
+static void
+sm__scene_command_fold(const struct scene_command *command, component_t *archetype, b32 *removed)
+{
+	switch (command->type)
+	{
+	case SCENE_COMMAND_ENTITY_REMOVE: *removed = true; break;
+	case SCENE_COMMAND_ADD_COMPONENT: *archetype |= command->components; break;
+	case SCENE_COMMAND_REMOVE_COMPONENT: *archetype &= ~command->components; break;
+	default: break;
+	}
+}
+
+void
+scene_command_playback(struct arena *arena, struct scene *scene)
+{
+	u32 command_count = 0;
+	u32 pending_count = 0;
+	for (u32 i = 0; i < ARRAY_SIZE(scene->commands); ++i)
+	{
+		command_count += scene->commands[i].count;
+		pending_count += scene->commands[i].created;
+	}
+
+	if (command_count == 0) { return; }
+
+	sm__assert(pending_count <= sm__handle_index_mask);
+
+	// the systems that recorded the commands have last_run equal to the current tick, what playback writes must be
+	// newer for them to see it on their next run
+	scene->tick++;
+
+	struct sm__scene_pending *pending = frame_alloc(pending_count * sizeof(struct sm__scene_pending));
+	entity_t *created = frame_alloc(pending_count * sizeof(entity_t));
+	struct sm__scene_command_key *keys = frame_alloc(command_count * sizeof(struct sm__scene_command_key));
+
+	// pending entities are renumbered to be unique across buffers, their creations are taken out of the list. The
+	// handles they end up with follow the system order of their creations, not this numbering
+	u32 key_count = 0;
+	u32 position = 0;
+	u32 pending_base = 0;
+	for (u32 i = 0; i < ARRAY_SIZE(scene->commands); ++i)
+	{
+		struct scene_command_buffer *buffer = &scene->commands[i];
+		for (struct scene_command_block *block = buffer->first; block; block = block->next)
+		{
+			for (u32 c = 0; c < block->len; ++c)
+			{
+				struct scene_command *command = &block->commands[c];
+				b32 is_pending = SCENE_COMMAND_IS_PENDING(command->entity.handle);
+				if (is_pending) { command->entity.handle += pending_base; }
+
+				u32 pending_index = (u32)command->entity.handle - 1;
+				if (command->type == SCENE_COMMAND_ENTITY_NEW)
+				{
+					pending[pending_index] = (struct sm__scene_pending){
+					    .archetype = command->components,
+					    .index = pending_index,
+					    .position = position++,
+					    .command = command,
+					};
+					continue;
+				}
+
+				if (is_pending)
+				{
+					struct sm__scene_pending *entity = &pending[pending_index];
+					sm__scene_command_fold(command, &entity->archetype, &entity->removed);
+				}
+
+				keys[key_count++] = (struct sm__scene_command_key){
+				    .handle = command->entity.handle, .position = position++, .command = command};
+			}
+		}
+
+		pending_base += buffer->created;
+		*buffer = (struct scene_command_buffer){0};
+	}
+
+	// one batch per archetype. Pending entities removed before playback are never created
+	qsort(pending, pending_count, sizeof(struct sm__scene_pending), sm__scene_pending_compare);
+	entity_t *batch = frame_alloc(pending_count * sizeof(entity_t));
+	for (u32 i = 0; i < pending_count;)
+	{
+		u32 end = i + 1;
+		while (end < pending_count && pending[end].removed == pending[i].removed &&
+		       pending[end].archetype == pending[i].archetype)
+		{
+			end++;
+		}
+
+		if (!pending[i].removed) { scene_entity_new_batch(arena, scene, pending[i].archetype, end - i, batch); }
+		for (u32 p = i; p < end; ++p)
+		{
+			created[pending[p].index].handle = pending[i].removed ? INVALID_HANDLE : batch[p - i].handle;
+		}
+
+		i = end;
+	}
+
+	for (u32 i = 0; i < key_count; ++i)
+	{
+		if (!SCENE_COMMAND_IS_PENDING(keys[i].handle)) { continue; }
+
+		keys[i].handle = created[keys[i].handle - 1].handle;
+		keys[i].command->entity.handle = keys[i].handle;
+	}
+
+	// every entity, in recording order, moves once to the archetype its commands end up with
+	qsort(keys, key_count, sizeof(struct sm__scene_command_key), sm__scene_command_compare);
+	for (u32 i = 0; i < key_count;)
+	{
+		entity_t entity = {keys[i].handle};
+
+		u32 end = i + 1;
+		while (end < key_count && keys[end].handle == entity.handle) { end++; }
+
+		b32 valid = entity.handle != INVALID_HANDLE && handle_valid(&scene->nodes_handle_pool, entity.handle);
+		if (!valid)
+		{
+			i = end;
+			continue;
+		}
+
+		struct node *node = &scene->nodes[handle_index(entity.handle)];
+		component_t archetype = node->archetype;
+		b32 removed = false;
+		for (u32 k = i; k < end; ++k) { sm__scene_command_fold(keys[k].command, &archetype, &removed); }
+
+		if (removed) { scene_entity_remove(scene, entity); }
+		else
+		{
+			if (archetype != node->archetype)
+			{
+				u32 comp_pool_index = sm__scene_archetype_get(arena, scene, archetype);
+				sm__scene_entity_move(arena, scene, entity, comp_pool_index);
+			}
+
+			for (u32 k = i; k < end; ++k)
+			{
+				const struct scene_command *command = keys[k].command;
+				if (command->type != SCENE_COMMAND_SET_COMPONENT) { continue; }
+
+				if (!(archetype & command->components))
+				{
+					log_warn(str8_from("entity {u6d} does not have {u6d} component"),
+					    (u64)entity.handle, command->components);
+					continue;
+				}
+
+				void *data = scene_component_get_data(scene, entity, command->components);
+				memcpy(data, command->data, ctable_components[fast_log2_64(command->components)].size);
+			}
+		}
+
+		i = end;
+	}
+}
+
 void
 scene_print_archeype(struct arena *arena, struct scene *scene, entity_t entity)
 {
@@ -6,12 +6,21 @@
 struct scene;
 typedef b32 (*system_f)(struct arena *arena, struct scene *scene, struct ctx *ctx, void *user_data);
 
+// Components a system reads and writes. Systems whose accesses do not conflict (neither writes what the other reads
+// or writes) run concurrently on the job system, the others keep their registration order.
+#define SYSTEM_ACCESS_ALL ((component_t)~0ull)
+
 struct system_info
 {
 	str8 name;
 	void *user_data;
 
 	system_f system;
+
+	component_t read;
+	component_t write;
+
+	u32 last_run; // scene tick of the level the system last ran in, 0 before its first run
 };
 
 typedef struct entity
@@ -23,8 +32,11 @@ struct node
 {
 	entity_t self;
 
+	// hierarchy links, INVALID_HANDLE when missing. Children form a doubly linked list threaded through the nodes
 	entity_t parent;
-	array(entity_t) children;
+	entity_t first_child;
+	entity_t next_sibling;
+	entity_t prev_sibling;
 
 	enum
 	{
@@ -40,6 +52,88 @@ struct node
 	u32 component_pool_index;
 };
 
+// Pools are found by archetype through an open addressing table keyed by the archetype mask. On top of it every pool
+// caches the pools reached by adding or removing a single component, so structural changes of the common kind cost an
+// array load before moving the row.
+#define SCENE_ARCHETYPE_NONE UINT32_MAX
+
+struct archetype_slot
+{
+	component_t archetype;
+	u32 comp_pool_index; // SCENE_ARCHETYPE_NONE when the slot is empty
+};
+
+struct archetype_edges
+{
+	// indexed by the log2 of the component, SCENE_ARCHETYPE_NONE until the transition is taken the first time
+	u32 add[64];
+	u32 remove[64];
+};
+
+#define SCENE_QUERY_NONE UINT32_MAX
+#define SCENE_SYSTEM_NONE UINT32_MAX
+
+// pools whose archetype has every component of with and none of without
+struct scene_query
+{
+	component_t with;
+	component_t without;
+	array(u32) comp_pools; // indices into scene->component_handle_pool, in creation order
+};
+
+typedef struct query
+{
+	u32 index;
+} query_t;
+
+// Transforms in topological order: breadth first from the roots, so a parent always comes before its children
+#define HIERARCHY_ROOT UINT32_MAX
+
+struct hierarchy_entry
+{
+	entity_t entity;
+	u32 parent; // index of the entry of the parent, HIERARCHY_ROOT when there is none
+};
+
+enum scene_command_type
+{
+	SCENE_COMMAND_ENTITY_NEW,
+	SCENE_COMMAND_ENTITY_REMOVE,
+	SCENE_COMMAND_ADD_COMPONENT,
+	SCENE_COMMAND_REMOVE_COMPONENT,
+	SCENE_COMMAND_SET_COMPONENT,
+};
+
+struct scene_command
+{
+	u32 type;
+	entity_t entity; // pending (see scene_command_entity_new) until playback resolves it
+	component_t components;
+	void *data; // SCENE_COMMAND_SET_COMPONENT, a copy of the component
+
+	u32 system; // index in scene->sys_info of the system recording it, SCENE_SYSTEM_NONE outside systems
+	u32 range;  // 1 + the scene_iter_parallel range recording it, 0 from the body of the system
+};
+
+#define SCENE_COMMAND_BLOCK_COUNT 128
+
+struct scene_command_block
+{
+	struct scene_command_block *next;
+	u32 len;
+	struct scene_command commands[SCENE_COMMAND_BLOCK_COUNT];
+};
+
+// Blocks come from the frame arena of the thread recording, one buffer per thread so that recording never locks.
+// Every buffer sits on its own cache line, threads recording at the same time do not share one
+sync_align_decl(64, struct) scene_command_buffer
+{
+	struct scene_command_block *first;
+	struct scene_command_block *last;
+	u32 count;
+	u32 created; // pending entities handed out
+};
+
 typedef void (*scene_pipeline_attach_f)(struct arena *arena, struct scene *scene, struct ctx *ctx);
 typedef void (*scene_pipeline_update_f)(struct arena *arena, struct scene *scene, struct ctx *ctx, void *user_data);
 typedef void (*scene_pipeline_draw_f)(struct arena *arena, struct scene *scene, struct ctx *ctx, void *user_data);
@@ -54,8 +148,23 @@ struct scene
 
 	entity_t main_camera;
 
+	// Advances before every level of scene_system_run, before every command playback that has work and once more
+	// after the last level, component writes are stamped with it. Starts at 1 so that entities created before the
+	// first run count as changed
+	u32 tick;
+
 	array(struct system_info) sys_info;
 	array(struct component_pool) component_handle_pool;
+	array(struct archetype_edges) archetype_edges; // parallel to component_handle_pool
+	struct archetype_slot *archetype_map;	       // archetype_map_cap slots, power of two
+	u32 archetype_map_cap;
+	array(struct scene_query) queries;
+
+	array(struct hierarchy_entry) hierarchy;
+	array(transform_component *) hierarchy_transforms; // parallel to hierarchy, scratch of scene_hierarchy_update
+	b32 hierarchy_stale; // parenting or the set of transforms changed since hierarchy was built
+
+	struct scene_command_buffer commands[JOB_MAX_WORKERS + 1]; // indexed by job_thread_index
 
 	void *user_data;
 	scene_pipeline_attach_f attach;
@@ -85,18 +194,30 @@ void scene_load(struct arena *arena, struct scene *scene, str8 name);
 void scene_unmake_refs(struct scene *scene);
 
 entity_t scene_entity_new(struct arena *arena, struct scene *scene, component_t archetype);
+// Creates count entities of archetype in one go, their components take contiguous rows of the pool
+void scene_entity_new_batch(
+    struct arena *arena, struct scene *scene, component_t archetype, u32 count, entity_t *out_entities);
+// Makes room for count more entities of archetype, so creating them afterwards does not reallocate
+void scene_reserve(struct arena *arena, struct scene *scene, component_t archetype, u32 count);
 void scene_entity_remove(struct scene *scene, entity_t entity);
 b32 scene_entity_is_valid(struct scene *scene, entity_t entity);
 b32 scene_entity_has_components(struct scene *scene, entity_t entity, component_t components);
 void scene_entity_add_component(struct arena *arena, struct scene *scene, entity_t entity, component_t components);
+void scene_entity_remove_component(struct arena *arena, struct scene *scene, entity_t entity, component_t components);
 void *scene_component_get_data(struct scene *scene, entity_t entity, component_t component);
+const void *scene_component_read_data(struct scene *scene, entity_t entity, component_t component);
 
 void scene_entity_set_dirty(struct scene *scene, entity_t entity, b32 dirty);
 b32 scene_entity_is_dirty(struct scene *scene, entity_t entity);
 void scene_entity_update_hierarchy(struct scene *scene, entity_t self);
+// Recomputes the world matrix of every dirty transform and everything below it in one forward pass over
+// scene->hierarchy, rebuilding the array first when parenting changed. Clean subtrees are skipped
+void scene_hierarchy_update(struct scene *scene);
 b32 scene_entity_is_descendant_of(struct scene *scene, entity_t self, entity_t entity);
 void scene_entity_set_parent(struct scene *scene, entity_t self, entity_t new_parent);
 void scene_entity_add_child(struct scene *scene, entity_t self, entity_t child);
+// The setters only write transform_local and mark the entity dirty, matrix and matrix_local follow on the next
+// scene_hierarchy_update. The world space ones read the parent matrix as of that last pass
 void scene_entity_set_position_local(struct scene *scene, entity_t self, v3 position);
 void scene_entity_set_position(struct scene *scene, entity_t self, v3 position);
 void scene_entity_set_rotation_local(struct scene *scene, entity_t self, v4 rotation);
@@ -105,7 +226,17 @@ void scene_entity_set_scale_local(struct scene *scene, entity_t self, v3 scale);
 void scene_entity_translate(struct scene *scene, entity_t self, v3 delta);
 void scene_entity_rotate(struct scene *scene, entity_t self, v4 delta);
 
+// Systems registered without access masks read and write everything: they run alone, after every system registered
+// before them and before every system registered after them.
 void scene_system_register(struct arena *arena, struct scene *scene, str8 name, system_f system, void *user_data);
+void scene_system_register_access(struct arena *arena, struct scene *scene, str8 name, system_f system,
+    void *user_data, component_t read, component_t write);
+
+// Runs the registered systems level by level. A system lands one level after the last system registered before it
+// that it conflicts with, systems sharing a level run concurrently. Systems running concurrently must not add or
+// remove entities or components, they record the change with the scene_command functions instead, and they get the
+// frame arena of the thread they run on in ctx->frame. Commands are played back at the end of every level.
+// A system returning false stops the levels after its own.
 void scene_system_run(struct arena *arena, struct scene *scene, struct ctx *ctx);
 
 struct scene_iter
@@ -113,17 +244,122 @@ struct scene_iter
 	REF(const struct scene) scene_ref;
 	b32 first_iter;
 	component_t constraint;
-	u32 comp_pool_index;
+	u32 query_index;     // SCENE_QUERY_NONE when iterating by constraint
+	u32 comp_pool_index; // into the pools of the query when there is one
 
 	u32 index;
 	REF(const struct component_pool) comp_pool_ref;
+
+	// see scene_iter_filter_changed
+	component_t changed;
+	u32 since;
 };
 
 struct scene_iter scene_iter_begin(struct scene *scene, component_t constraint);
 b32 scene_iter_next(struct scene *scene, struct scene_iter *iter);
 void *scene_iter_get_component(struct scene_iter *iter, component_t component);
+const void *scene_iter_read_component(struct scene_iter *iter, component_t component);
 entity_t scene_iter_get_entity(struct scene_iter *iter);
 
+// Chunk iteration
+// Walks the storage chunks of the pools matching the constraint. Each step exposes count entities and
+// scene_chunk_iter_get_column hands out the component arrays, element i of every column belongs to the same entity.
+struct scene_chunk_iter
+{
+	REF(const struct scene) scene_ref;
+	component_t constraint;
+	u32 query_index;
+	u32 comp_pool_index;
+	u32 chunk_index;
+
+	// valid after scene_chunk_iter_next returned true
+	REF(const struct component_pool) comp_pool_ref;
+	u32 first_row; // row of the first entity in the chunk
+	u32 count;
+
+	// see scene_chunk_iter_filter_changed
+	component_t changed;
+	u32 since;
+};
+
+struct scene_chunk_iter scene_chunk_iter_begin(struct scene *scene, component_t constraint);
+b32 scene_chunk_iter_next(struct scene_chunk_iter *iter);
+void *scene_chunk_iter_get_column(struct scene_chunk_iter *iter, component_t component);
+const void *scene_chunk_iter_read_column(struct scene_chunk_iter *iter, component_t component);
+// element i is the entity owning element i of the columns
+const entity_t *scene_chunk_iter_get_entities(struct scene_chunk_iter *iter);
+
+// Parallel iteration
+// Every storage chunk of the pools matching the constraint becomes one range, the ranges are spread over the job
+// system and the call returns once all of them are done. Each callback gets the rows of one chunk and must only
+// touch the entities inside it.
+
+struct scene_iter_range
+{
+	REF(const struct component_pool) comp_pool_ref;
+	REF(const struct component_view) view; // comp_pool_ref->view, indexed by fast_log2_64(component)
+
+	u32 begin; // [begin, end) rows of comp_pool_ref, all inside the same chunk
+	u32 end;
+
+	u32 tick; // scene tick the writes are stamped with
+};
+
+typedef void (*scene_iter_parallel_f)(const struct scene_iter_range *range, void *user_data);
+
+void scene_iter_parallel(struct scene *scene, component_t constraint, scene_iter_parallel_f fn, void *user_data);
+void *scene_iter_range_get_component(const struct scene_iter_range *range, u32 index, component_t component);
+// component of the row range->begin, the following end - begin - 1 rows come right after it
+void *scene_iter_range_get_column(const struct scene_iter_range *range, component_t component);
+const void *scene_iter_range_read_component(const struct scene_iter_range *range, u32 index, component_t component);
+const void *scene_iter_range_read_column(const struct scene_iter_range *range, component_t component);
+entity_t scene_iter_range_get_entity(const struct scene_iter_range *range, u32 index);
+
+// Change detection
+// Handing out a component through a get accessor stamps it, and the chunk it lives in, with the scene tick: the
+// caller is assumed to write it. The read accessors hand out the same data without stamping, systems that only look
+// at a component should use them or everybody downstream sees it changing every frame. Creating an entity or moving
+// it to another archetype stamps all of its components.
+//
+// A filtered iterator only stops at entities where at least one component of changed was stamped after since,
+// chunks where none was are skipped without looking at their rows. Set the filter before the first next.
+// scene_system_last_run gives the tick a system should pass as since to see what changed after its previous run.
+void scene_iter_filter_changed(struct scene_iter *iter, component_t changed, u32 since);
+void scene_chunk_iter_filter_changed(struct scene_chunk_iter *iter, component_t changed, u32 since);
+// Only meaningful inside a system run by scene_system_run, returns 0 (everything changed) anywhere else
+u32 scene_system_last_run(void);
+
+// Queries
+// A query keeps the list of pools it matches. The list is filled when the query is registered and extended whenever
+// the scene creates a pool, so beginning an iteration over a query does not look at any archetype. Register queries
+// once, at attach time, and iterate them every frame. Registering the same masks twice returns the same query.
+query_t scene_query_register(struct arena *arena, struct scene *scene, component_t with, component_t without);
+struct scene_iter scene_query_iter_begin(struct scene *scene, query_t query);
+struct scene_chunk_iter scene_query_chunk_iter_begin(struct scene *scene, query_t query);
+void scene_query_iter_parallel(struct scene *scene, query_t query, scene_iter_parallel_f fn, void *user_data);
+
+// Command buffers
+// Structural changes recorded now and applied by scene_command_playback, so that they can be made while iterating
+// or from systems and jobs running concurrently. Every thread records into its own buffer: only the main thread and
+// the job system workers may record. scene_system_run plays back at the end of every level and the stage after
+// update and after draw, commands must not outlive the frame since they live in the frame arena.
+//
+// scene_command_entity_new hands out a pending entity. It can be passed to the other commands recorded by the same
+// thread before the next playback and is meaningless to anything else.
+//
+// Playback does not depend on which thread recorded what: the commands of an entity are applied in registration order
+// of the systems that recorded them, then in range order for scene_iter_parallel, then in recording order. Pending
+// entities are numbered in that same order. Creations are batched per archetype, with the components added or removed
+// by later commands folded in, and an existing entity moves to its final archetype once no matter how many components
+// it gained or lost. A set copies the component over once the entity has its final archetype, like a write through
+// scene_component_get_data would.
+entity_t scene_command_entity_new(struct scene *scene, component_t archetype);
+void scene_command_entity_remove(struct scene *scene, entity_t entity);
+void scene_command_add_component(struct scene *scene, entity_t entity, component_t components);
+void scene_command_remove_component(struct scene *scene, entity_t entity, component_t components);
+void scene_command_set_component(struct scene *scene, entity_t entity, component_t component, const void *data);
+void scene_command_playback(struct arena *arena, struct scene *scene);
+
 void scene_print_archeype(struct arena *arena, struct scene *scene, entity_t entity);
 
 #endif // SM_ECS_SCENE
@@ -32,6 +32,7 @@ b8
 stage_init(struct buf base_memory)
 {
 	arena_make(&SC.global_arena, base_memory);
+	arena_set_name(&SC.global_arena, str8_from("stage"));
 	SC.sub_arena_size = base_memory.size / 8;
 
 	dll_init_sentinel(&SC.scenes_active);
@@ -71,20 +72,21 @@ stage_on_update(struct ctx *ctx)
 {
 	scene_system_run(&SC.current->arena, &SC.current->scene, ctx);
 	scene_on_update(&SC.current->arena, &SC.current->scene, ctx);
+	scene_command_playback(&SC.current->arena, &SC.current->scene);
 }
 
 void
 stage_on_draw(struct ctx *ctx)
 {
 	scene_on_draw(&SC.current->arena, &SC.current->scene, ctx);
+	scene_command_playback(&SC.current->arena, &SC.current->scene);
 }
 
 static void
 sm__stage_construct(struct scene_object *scene_obj)
 {
-	struct buf base_memory = {
-	    .data = arena_reserve(&SC.global_arena, SC.sub_arena_size), .size = SC.sub_arena_size};
-	arena_make(&scene_obj->arena, base_memory);
+	arena_make_child(&SC.global_arena, &scene_obj->arena, SC.sub_arena_size);
+	arena_set_name(&scene_obj->arena, scene_obj->name);
 	scene_make(&scene_obj->arena, &scene_obj->scene);
 }
 
@@ -177,6 +179,18 @@ stage_entity_new(component_t archetype)
 	return scene_entity_new(&SC.current->arena, &SC.current->scene, archetype);
 }
 
+void
+stage_entity_new_batch(component_t archetype, u32 count, entity_t *out_entities)
+{
+	scene_entity_new_batch(&SC.current->arena, &SC.current->scene, archetype, count, out_entities);
+}
+
+void
+stage_reserve(component_t archetype, u32 count)
+{
+	scene_reserve(&SC.current->arena, &SC.current->scene, archetype, count);
+}
+
 void
 stage_entity_remove(entity_t entity)
 {
@@ -201,18 +215,66 @@ stage_entity_add_component(entity_t entity, component_t components)
 	scene_entity_add_component(&SC.current->arena, &SC.current->scene, entity, components);
 }
 
+void
+stage_entity_remove_component(entity_t entity, component_t components)
+{
+	scene_entity_remove_component(&SC.current->arena, &SC.current->scene, entity, components);
+}
+
+entity_t
+stage_command_entity_new(component_t archetype)
+{
+	return scene_command_entity_new(&SC.current->scene, archetype);
+}
+
+void
+stage_command_entity_remove(entity_t entity)
+{
+	scene_command_entity_remove(&SC.current->scene, entity);
+}
+
+void
+stage_command_add_component(entity_t entity, component_t components)
+{
+	scene_command_add_component(&SC.current->scene, entity, components);
+}
+
+void
+stage_command_remove_component(entity_t entity, component_t components)
+{
+	scene_command_remove_component(&SC.current->scene, entity, components);
+}
+
+void
+stage_command_set_component(entity_t entity, component_t component, const void *data)
+{
+	scene_command_set_component(&SC.current->scene, entity, component, data);
+}
+
 void *
 stage_component_get_data(entity_t entity, component_t component)
 {
 	return scene_component_get_data(&SC.current->scene, entity, component);
 }
 
+const void *
+stage_component_read_data(entity_t entity, component_t component)
+{
+	return scene_component_read_data(&SC.current->scene, entity, component);
+}
+
 void
 stage_system_register(str8 name, system_f system, void *user_data)
 {
 	scene_system_register(&SC.current->arena, &SC.current->scene, name, system, user_data);
 }
 
+void
+stage_system_register_access(str8 name, system_f system, void *user_data, component_t read, component_t write)
+{
+	scene_system_register_access(&SC.current->arena, &SC.current->scene, name, system, user_data, read, write);
+}
+
 struct scene_iter
 stage_iter_begin(component_t constraint)
 {
@@ -230,3 +292,57 @@ stage_iter_get_component(struct scene_iter *iter, component_t component)
 {
 	return scene_iter_get_component(iter, component);
 }
+
+const void *
+stage_iter_read_component(struct scene_iter *iter, component_t component)
+{
+	return scene_iter_read_component(iter, component);
+}
+
+struct scene_chunk_iter
+stage_chunk_iter_begin(component_t constraint)
+{
+	return scene_chunk_iter_begin(&SC.current->scene, constraint);
+}
+
+query_t
+stage_query_register(component_t with, component_t without)
+{
+	return scene_query_register(&SC.current->arena, &SC.current->scene, with, without);
+}
+
+struct scene_iter
+stage_query_iter_begin(query_t query)
+{
+	return scene_query_iter_begin(&SC.current->scene, query);
+}
+
+struct scene_chunk_iter
+stage_query_chunk_iter_begin(query_t query)
+{
+	return scene_query_chunk_iter_begin(&SC.current->scene, query);
+}
+
+b8
+stage_chunk_iter_next(struct scene_chunk_iter *iter)
+{
+	return scene_chunk_iter_next(iter);
+}
+
+void *
+stage_chunk_iter_get_column(struct scene_chunk_iter *iter, component_t component)
+{
+	return scene_chunk_iter_get_column(iter, component);
+}
+
+const void *
+stage_chunk_iter_read_column(struct scene_chunk_iter *iter, component_t component)
+{
+	return scene_chunk_iter_read_column(iter, component);
+}
+
+const entity_t *
+stage_chunk_iter_get_entities(struct scene_chunk_iter *iter)
+{
+	return scene_chunk_iter_get_entities(iter);
+}
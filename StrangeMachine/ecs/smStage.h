@@ -21,15 +21,36 @@ struct scene *stage_get_current_scene(void);
 struct arena *stage_scene_get_arena(void);
 entity_t stage_animated_asset_load(str8 name);
 entity_t stage_entity_new(component_t archetype);
+void stage_entity_new_batch(component_t archetype, u32 count, entity_t *out_entities);
+void stage_reserve(component_t archetype, u32 count);
 void stage_entity_remove(entity_t entity);
 b8 stage_entity_is_valid(entity_t entity);
 b8 stage_entity_has_components(entity_t entity, component_t components);
 void stage_entity_add_component(entity_t entity, component_t components);
+void stage_entity_remove_component(entity_t entity, component_t components);
+entity_t stage_command_entity_new(component_t archetype);
+void stage_command_entity_remove(entity_t entity);
+void stage_command_add_component(entity_t entity, component_t components);
+void stage_command_remove_component(entity_t entity, component_t components);
+void stage_command_set_component(entity_t entity, component_t component, const void *data);
 void *stage_component_get_data(entity_t entity, component_t component);
+const void *stage_component_read_data(entity_t entity, component_t component);
 void stage_system_register(str8 name, system_f system, void *user_data);
+void stage_system_register_access(str8 name, system_f system, void *user_data, component_t read, component_t write);
 
 struct scene_iter stage_iter_begin(component_t constraint);
 b8 stage_iter_next(struct scene_iter *iter);
 void *stage_iter_get_component(struct scene_iter *iter, component_t component);
+const void *stage_iter_read_component(struct scene_iter *iter, component_t component);
+
+struct scene_chunk_iter stage_chunk_iter_begin(component_t constraint);
+b8 stage_chunk_iter_next(struct scene_chunk_iter *iter);
+void *stage_chunk_iter_get_column(struct scene_chunk_iter *iter, component_t component);
+const void *stage_chunk_iter_read_column(struct scene_chunk_iter *iter, component_t component);
+const entity_t *stage_chunk_iter_get_entities(struct scene_chunk_iter *iter);
+
+query_t stage_query_register(component_t with, component_t without);
+struct scene_iter stage_query_iter_begin(query_t query);
+struct scene_chunk_iter stage_query_chunk_iter_begin(query_t query);
 
 #endif // SM_ECS_stage_H
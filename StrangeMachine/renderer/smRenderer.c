@@ -1440,8 +1440,8 @@ renderer_texture_make(const struct renderer_texture_desc *desc)
 			{
 				texture_at->resource_handle.id = desc_def.handle.id;
 
-				log_trace(str8_from("[{s}] creating texture from handle {u3d}"), desc_def.label,
-				    desc_def.handle.id);
+				log_trace(str8_from("[{s}] creating texture from handle {u6d}"), desc_def.label,
+				    (u64)desc_def.handle.id);
 			}
 			else
 			{
@@ -2844,9 +2844,9 @@ static void
 sm__before_draw(void)
 {
 	// clang-format off
-	log_trace(str8_from("* shader  : {u3d}"), RC.current.shader.id);
-	log_trace(str8_from("* pipeline: {u3d}"), RC.current.pipeline.id);
-	log_trace(str8_from("* pass    : {u3d}"), RC.current.pass.id);
+	log_trace(str8_from("* shader  : {u6d}"), (u64)RC.current.shader.id);
+	log_trace(str8_from("* pipeline: {u6d}"), (u64)RC.current.pipeline.id);
+	log_trace(str8_from("* pass    : {u6d}"), (u64)RC.current.pass.id);
 	log_trace(str8_from("	- pass width  : {u3d}"), RC.current.pass_width);
 	log_trace(str8_from("	- pass height : {u3d}"), RC.current.pass_height);
 	log_trace(str8_from("	- enable      : {b}"), (b8)RC.current.in_pass);
@@ -2878,7 +2878,7 @@ sm__before_draw(void)
 	}
 	else
 	{
-		log_trace(str8_from("		- [{u3d}] {s}, texture: {u3d}, sampler: {u3d}"), i, slot->name, slot->texture.id, slot->sampler.id);
+		log_trace(str8_from("		- [{u3d}] {s}, texture: {u6d}, sampler: {u6d}"), i, slot->name, (u64)slot->texture.id, (u64)slot->sampler.id);
 	}
 	}
 
@@ -2893,11 +2893,11 @@ sm__before_draw(void)
 	}
 	else
 	{
-		log_trace(str8_from("		- [{u3d}] {s}, buffer: {u3d}"), i, slot->name, slot->buffer.id);
+		log_trace(str8_from("		- [{u3d}] {s}, buffer: {u6d}"), i, slot->name, (u64)slot->buffer.id);
 	}
 	}
 	log_trace(str8_from("	* index buffer: "));
-	log_trace(str8_from("		- [0] {u3d}"), RC.current.gl.index_buffer.id);
+	log_trace(str8_from("		- [0] {u6d}"), (u64)RC.current.gl.index_buffer.id);
 
 	struct renderer_pipeline *pip = renderer_pipeline_at(RC.current.pipeline);
 
@@ -2960,10 +2960,11 @@ sm__renderer_default_state(void)
 }
 
 b32
-renderer_init(u32 framebuffer_width, u32 framebuffer_height)
+renderer_init(u32 framebuffer_width, u32 framebuffer_height, u32 budget)
 {
-	struct buf renderer_base_memory = base_memory_reserve(MB(1));
+	struct buf renderer_base_memory = base_memory_reserve(budget);
 	arena_make(&RC.arena, renderer_base_memory);
+	arena_set_name(&RC.arena, str8_from("renderer"));
 	arena_validate(&RC.arena);
 
 	// sm__renderer_batch_make(&RC.arena, &RC.batch);
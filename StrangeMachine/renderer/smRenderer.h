@@ -5,7 +5,7 @@
 #include "core/smResource.h"
 #include "math/smMath.h"
 
-b32 renderer_init(u32 framebuffer_width, u32 framebuffer_height);
+b32 renderer_init(u32 framebuffer_width, u32 framebuffer_height, u32 budget);
 void renderer_teardown(void);
 
 struct renderer_slot
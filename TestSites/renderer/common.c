@@ -506,63 +506,66 @@ common_pe_sort_update(sm__maybe_unused struct arena *arena, sm__maybe_unused str
     sm__maybe_unused struct ctx *ctx, sm__maybe_unused void *user_data)
 {
 	entity_t main_camera_entity = scene_get_main_camera(scene);
-	transform_component *camera_transform = scene_component_get_data(scene, main_camera_entity, TRANSFORM);
+	const transform_component *camera_transform = scene_component_read_data(scene, main_camera_entity, TRANSFORM);
 	v3 camera_position = camera_transform->matrix.v3.position;
 
-	struct scene_iter iter = scene_iter_begin(scene, TRANSFORM | PARTICLE_EMITTER);
+	struct scene_chunk_iter iter = scene_chunk_iter_begin(scene, TRANSFORM | PARTICLE_EMITTER);
 
-	while (scene_iter_next(scene, &iter))
+	while (scene_chunk_iter_next(&iter))
 	{
-		transform_component *transform = scene_iter_get_component(&iter, TRANSFORM);
-		particle_emitter_component *pe = scene_iter_get_component(&iter, PARTICLE_EMITTER);
+		particle_emitter_component *emitters = scene_chunk_iter_get_column(&iter, PARTICLE_EMITTER);
+		for (u32 e = 0; e < iter.count; ++e)
+		{
+			particle_emitter_component *pe = &emitters[e];
 
 #if defined(PARTICLE_USE_POOL)
-		for (u32 i = 0; i < pe->pool_size; ++i)
-		{
-			struct particle *p1 = &pe->particles_pool[i];
-			f32 p1_distance = glm_vec3_distance2(p1->position.data, camera_position.data);
-			for (u32 j = i + 1; j < pe->pool_size; ++j)
+			for (u32 i = 0; i < pe->pool_size; ++i)
 			{
-				struct particle *p2 = &pe->particles_pool[j];
-				if (p1->energy_remaing <= 0.0f)
+				struct particle *p1 = &pe->particles_pool[i];
+				f32 p1_distance = glm_vec3_distance2(p1->position.data, camera_position.data);
+				for (u32 j = i + 1; j < pe->pool_size; ++j)
 				{
-					*p1 = *p2;
-					p2->energy_remaing = 0.0f;
-					continue;
-				}
+					struct particle *p2 = &pe->particles_pool[j];
+					if (p1->energy_remaing <= 0.0f)
+					{
+						*p1 = *p2;
+						p2->energy_remaing = 0.0f;
+						continue;
+					}
 
-				f32 p2_distance = glm_vec3_distance2(p2->position.data, camera_position.data);
-				if (p2_distance < p1_distance)
-				{
-					struct particle p_swap = *p1;
-					*p1 = *p2;
-					*p2 = p_swap;
+					f32 p2_distance = glm_vec3_distance2(p2->position.data, camera_position.data);
+					if (p2_distance < p1_distance)
+					{
+						struct particle p_swap = *p1;
+						*p1 = *p2;
+						*p2 = p_swap;
+					}
 				}
 			}
-		}
 
 #else
-		struct particle *p = 0, *i = 0, *next = 0;
-		for (p = pe->active_sentinel.next; p != &pe->active_sentinel; p = next)
-		{
-			next = p->next;
+			struct particle *p = 0, *i = 0, *next = 0;
+			for (p = pe->active_sentinel.next; p != &pe->active_sentinel; p = next)
+			{
+				next = p->next;
 
-			// TODO: particle position in world space
+				// TODO: particle position in world space
 
-			// TODO: swap particles instead of using double linked list. Its better for the cache
+				// TODO: swap particles instead of using double linked list. Its better for the cache
 
-			// squared distance between the particle and the camera
-			f32 particle_distance = glm_vec3_distance2(p->position.data, camera_position.data);
-			for (i = next; i != &pe->active_sentinel; i = i->next)
-			{
-				if (particle_distance < glm_vec3_distance2(i->position.data, camera_position.data))
+				// squared distance between the particle and the camera
+				f32 particle_distance = glm_vec3_distance2(p->position.data, camera_position.data);
+				for (i = next; i != &pe->active_sentinel; i = i->next)
 				{
-					dll_remove(p);
-					dll_insert(i, p);
+					if (particle_distance < glm_vec3_distance2(i->position.data, camera_position.data))
+					{
+						dll_remove(p);
+						dll_insert(i, p);
+					}
 				}
 			}
-		}
 #endif
+		}
 	}
 
 	return (1);
@@ -978,6 +981,8 @@ camera_update_input(struct scene *scene, entity_t entity, camera_component *came
 		scene_entity_set_rotation_local(scene, entity, rotation);
 	}
 
+	// the setters above only mark the camera dirty, the lerp reads its world matrix
+	scene_entity_update_hierarchy(scene, entity);
 	camera_lerp_to_entity(scene, entity, camera, transform, ctx);
 }
 
@@ -994,7 +999,10 @@ common_camera_update(
 
 		cam->aspect_ratio = (f32)ctx->win_width / (f32)ctx->win_height;
 
+		// the Hierarchy system runs after this one, refresh the camera world matrix before and after moving it
+		scene_entity_update_hierarchy(scene, camera_ett);
 		camera_update_input(scene, camera_ett, cam, transform, ctx);
+		scene_entity_update_hierarchy(scene, camera_ett);
 
 		// Get the view matrix
 		v3 eye = transform->matrix.v3.position;
@@ -1033,17 +1041,30 @@ common_transform_clear_dirty(
 	return (1);
 }
 
-b32
-common_cfc_update(
-    struct arena *arena, struct scene *scene, sm__maybe_unused struct ctx *ctx, sm__maybe_unused void *user_data)
+struct cfc_update
 {
-	struct scene_iter iter = scene_iter_begin(scene, CROSS_FADE_CONTROLLER | ARMATURE | POSE | CLIP);
-	while (scene_iter_next(scene, &iter))
+	struct arena *arena;
+	struct ctx *ctx;
+};
+
+static void
+common_cfc_update_range(const struct scene_iter_range *range, void *user_data)
+{
+	struct cfc_update *update = user_data;
+	struct arena *arena = update->arena;
+	struct ctx *ctx = update->ctx;
+
+	cross_fade_controller_component *cfcs = scene_iter_range_get_column(range, CROSS_FADE_CONTROLLER);
+	pose_component *poses = scene_iter_range_get_column(range, POSE);
+	clip_component *clips = scene_iter_range_get_column(range, CLIP);
+	const armature_component *armatures = scene_iter_range_read_column(range, ARMATURE);
+
+	for (u32 e = 0; e < range->end - range->begin; ++e)
 	{
-		cross_fade_controller_component *cfc = scene_iter_get_component(&iter, CROSS_FADE_CONTROLLER);
-		pose_component *current = scene_iter_get_component(&iter, POSE);
-		clip_component *clip = scene_iter_get_component(&iter, CLIP);
-		armature_component *armature = scene_iter_get_component(&iter, ARMATURE);
+		cross_fade_controller_component *cfc = &cfcs[e];
+		pose_component *current = &poses[e];
+		clip_component *clip = &clips[e];
+		const armature_component *armature = &armatures[e];
 
 		if (clip->current_clip_handle.id == INVALID_HANDLE)
 		{
@@ -1060,7 +1081,7 @@ common_cfc_update(
 				clip->time = cfc->targets[i].time;
 				pose_copy(arena, current, cfc->targets[i].pose_ref);
 
-				array_del(cfc->targets, i, 1);
+				array_del(cfc->targets, (i32)i, 1);
 				break;
 			}
 		}
@@ -1087,6 +1108,16 @@ common_cfc_update(
 			pose_blend(current, current, target->pose_ref, t, -1);
 		}
 	}
+}
+
+b32
+common_cfc_update(
+    struct arena *arena, struct scene *scene, sm__maybe_unused struct ctx *ctx, sm__maybe_unused void *user_data)
+{
+	// entities only touch their own components, the chunks run on the job system
+	struct cfc_update update = {.arena = arena, .ctx = ctx};
+	scene_iter_parallel(scene, CROSS_FADE_CONTROLLER | ARMATURE | POSE | CLIP, common_cfc_update_range, &update);
+
 	return (1);
 }
 
@@ -1115,7 +1146,7 @@ common_fade_to_update(
 		struct sm__resource_armature *armature_resource = resource_armature_at(armature->armature_handle);
 		if (clip->current_clip_handle.id == INVALID_HANDLE && clip->next_clip_handle.id != INVALID_HANDLE)
 		{
-			array_set_len(arena, cfc->targets, 0);
+			array_clear(cfc->targets);
 			clip->current_clip_handle = clip->next_clip_handle;
 
 			struct sm__resource_clip *clip_resource = resource_clip_at(clip->current_clip_handle);
@@ -1157,13 +1188,15 @@ b32
 common_m4_palette_update(
     struct arena *arena, struct scene *scene, sm__maybe_unused struct ctx *ctx, sm__maybe_unused void *user_data)
 {
+	// the palette only moves with the pose
 	struct scene_iter iter = scene_iter_begin(scene, MESH | ARMATURE | POSE);
+	scene_iter_filter_changed(&iter, POSE, scene_system_last_run());
 
 	while (scene_iter_next(scene, &iter))
 	{
-		pose_component *current = scene_iter_get_component(&iter, POSE);
-		armature_component *armature = scene_iter_get_component(&iter, ARMATURE);
-		mesh_component *mesh = scene_iter_get_component(&iter, MESH);
+		const pose_component *current = scene_iter_read_component(&iter, POSE);
+		const armature_component *armature = scene_iter_read_component(&iter, ARMATURE);
+		const mesh_component *mesh = scene_iter_read_component(&iter, MESH);
 
 		struct sm__resource_mesh *mesh_resource = resource_mesh_at(mesh->mesh_handle);
 		struct sm__resource_armature *armature_resource = resource_armature_at(armature->armature_handle);
@@ -1188,15 +1221,7 @@ b32
 common_hierarchy_update(sm__maybe_unused struct arena *arena, sm__maybe_unused struct scene *scene,
     sm__maybe_unused struct ctx *ctx, sm__maybe_unused void *user_data)
 {
-	struct scene_iter iter = scene_iter_begin(scene, TRANSFORM);
-	while (scene_iter_next(scene, &iter))
-	{
-		entity_t entity = scene_iter_get_entity(&iter);
-		if (scene_entity_is_dirty(scene, entity))
-		{
-			scene_entity_update_hierarchy(scene, entity);
-		}
-	}
+	scene_hierarchy_update(scene);
 
 	return (1);
 }
@@ -11,6 +11,8 @@ struct scene01
 	entity_t camera_ett;
 	entity_t player_ett;
 
+	query_t static_meshes; // skinned meshes go through their own pipeline
+
 	struct
 	{
 		pass_handle pass;
@@ -234,6 +236,8 @@ scene01_on_attach(struct arena *arena, sm__maybe_unused struct scene *scene, str
 	struct scene01 *scene01 = arena_reserve(arena, sizeof(struct scene01));
 	scene->user_data = scene01;
 
+	scene01->static_meshes = scene_query_register(arena, scene, TRANSFORM | MESH | MATERIAL, ARMATURE);
+
 	scene01->camera_ett = scene_entity_new(arena, scene, CAMERA | TRANSFORM);
 	scene_set_main_camera(scene, scene01->camera_ett);
 
@@ -457,17 +461,22 @@ scene01_on_attach(struct arena *arena, sm__maybe_unused struct scene *scene, str
 	audio_add_sound(str8_from("step2"), str8_from("exported/foottapping_02.wav"));
 	audio_add_sound(str8_from("step3"), str8_from("exported/foottapping_03.wav"));
 
-	scene_system_register(arena, scene, str8_from("Mesh"), common_mesh_calculate_aabb_update, scene01);
+	scene_system_register_access(
+	    arena, scene, str8_from("Mesh"), common_mesh_calculate_aabb_update, scene01, MESH, MESH);
 	scene_system_register(arena, scene, str8_from("Rigid body"), common_rigid_body_update, scene01);
 	scene_system_register(arena, scene, str8_from("Particle emitter"), common_particle_emitter_update, scene01);
 	scene_system_register(arena, scene, str8_from("Player"), scene01_player_update, scene01);
 	scene_system_register(arena, scene, str8_from("Camera"), common_camera_update, scene01);
 	scene_system_register(arena, scene, str8_from("Hierarchy"), common_hierarchy_update, scene01);
 	scene_system_register(arena, scene, str8_from("Transform clear"), common_transform_clear_dirty, scene01);
-	scene_system_register(arena, scene, str8_from("Particle emitter sort"), common_pe_sort_update, scene01);
-	scene_system_register(arena, scene, str8_from("Cross fade controller"), common_cfc_update, scene01);
-	scene_system_register(arena, scene, str8_from("Fade to"), common_fade_to_update, scene01);
-	scene_system_register(arena, scene, str8_from("Palette"), common_m4_palette_update, scene01);
+	scene_system_register_access(arena, scene, str8_from("Particle emitter sort"), common_pe_sort_update, scene01,
+	    TRANSFORM | PARTICLE_EMITTER, PARTICLE_EMITTER);
+	scene_system_register_access(arena, scene, str8_from("Cross fade controller"), common_cfc_update, scene01,
+	    ARMATURE, CROSS_FADE_CONTROLLER | POSE | CLIP);
+	scene_system_register_access(arena, scene, str8_from("Fade to"), common_fade_to_update, scene01, ARMATURE,
+	    CROSS_FADE_CONTROLLER | POSE | CLIP);
+	scene_system_register_access(
+	    arena, scene, str8_from("Palette"), common_m4_palette_update, scene01, ARMATURE | POSE, MESH);
 
 	// scene_load(arena, scene, str8_from("praca-scene"));
 	// scene_load(arena, scene, str8_from("simple-cube-scene"));
@@ -623,15 +632,9 @@ scene01_on_draw(struct arena *arena, struct scene *scene, struct ctx *ctx, void
 	renderer_pass_begin(scene01->first.pass, &scene01->display.pass_action);
 	renderer_pipiline_apply(scene01->first.pipeline);
 
-	struct scene_iter iter = scene_iter_begin(scene, TRANSFORM | MESH | MATERIAL);
+	struct scene_iter iter = scene_query_iter_begin(scene, scene01->static_meshes);
 	while (scene_iter_next(scene, &iter))
 	{
-		entity_t entity = scene_iter_get_entity(&iter);
-		if (scene_entity_has_components(scene, entity, ARMATURE))
-		{
-			continue;
-		}
-
 		transform_component *transform = scene_iter_get_component(&iter, TRANSFORM);
 		mesh_component *mesh = scene_iter_get_component(&iter, MESH);
 		material_component *material = scene_iter_get_component(&iter, MATERIAL);
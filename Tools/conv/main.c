@@ -324,6 +324,17 @@ sm__gltf_load_skinned_mesh(
 	cgltf_size accessor_count = accessor->count;
 
 	// clang-format off
+	switch (attr_type)
+	{
+	case cgltf_attribute_type_position: array_reserve(Garena, mesh->positions, accessor_count); break;
+	case cgltf_attribute_type_texcoord: array_reserve(Garena, mesh->uvs, accessor_count); break;
+	case cgltf_attribute_type_normal: array_reserve(Garena, mesh->normals, accessor_count); break;
+	case cgltf_attribute_type_color: array_reserve(Garena, mesh->colors, accessor_count); break;
+	case cgltf_attribute_type_weights: array_reserve(Garena, mesh->skin_data.weights, accessor_count); break;
+	case cgltf_attribute_type_joints: array_reserve(Garena, mesh->skin_data.influences, accessor_count); break;
+	default: break;
+	}
+
 	for (u32 i = 0; i < accessor_count; ++i)
 	{
 		u32 idx = i * component_count;
@@ -1190,7 +1201,7 @@ i32
 main(i32 argc, i8 *argv[])
 {
 	u32 base_size = MB(50);
-	if (!base_memory_init(base_size))
+	if (!base_memory_init(base_size, false))
 	{
 		printf("error allocating base mem!\n");
 		return (false);